@@ -0,0 +1,196 @@
+﻿
+#include "../loofah_config.h"
+
+#include <assert.h>
+#include <stdint.h> // for SIZE_MAX
+#include <algorithm> // for std::max()
+
+#include <nut/logging/logger.h>
+
+#include "utils.h"
+#include "event_loop_group.h"
+
+
+#define TAG "loofah.inet_base.event_loop_group"
+
+namespace loofah
+{
+
+EventLoopGroupBase::~EventLoopGroupBase() noexcept
+{
+    assert(_threads.empty());
+}
+
+bool EventLoopGroupBase::start(size_t loop_count, bool pin_threads) noexcept
+{
+    assert(_threads.empty());
+
+    if (0 == loop_count)
+        loop_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    _stopping.store(false, std::memory_order_relaxed);
+    _loops.assign(loop_count, nullptr);
+    _pending_counts.reset(new std::atomic<size_t>[loop_count]);
+    for (size_t i = 0; i < loop_count; ++i)
+        _pending_counts[i].store(0, std::memory_order_relaxed);
+    _started_count = 0;
+
+    for (size_t i = 0; i < loop_count; ++i)
+        _threads.emplace_back([=] { loop_thread_main(i, pin_threads); });
+
+    // 等待所有 poller 创建完成
+    std::unique_lock<std::mutex> guard(_lock);
+    while (_started_count < loop_count)
+        _condition.wait(guard);
+    for (size_t i = 0; i < loop_count; ++i)
+    {
+        if (nullptr == _loops[i])
+        {
+            guard.unlock();
+            NUT_LOG_E(TAG, "failed to start event loop %d", (int) i);
+            stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+void EventLoopGroupBase::stop() noexcept
+{
+    assert(nullptr == current_loop());
+
+    if (_threads.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopping.store(true, std::memory_order_relaxed);
+        for (PollerBase *loop : _loops)
+        {
+            if (nullptr != loop)
+                loop->wakeup_poll_wait();
+        }
+    }
+    _condition.notify_all();
+
+    for (std::thread& t : _threads)
+        t.join();
+    _threads.clear();
+    _loops.clear();
+    _pending_counts.reset();
+}
+
+size_t EventLoopGroupBase::size() const noexcept
+{
+    return _loops.size();
+}
+
+void EventLoopGroupBase::set_select_policy(SelectPolicy policy) noexcept
+{
+    _select_policy = policy;
+}
+
+PollerBase* EventLoopGroupBase::get_loop(size_t index) const noexcept
+{
+    assert(index < _loops.size());
+    return _loops[index];
+}
+
+size_t EventLoopGroupBase::select_index() noexcept
+{
+    assert(!_loops.empty());
+
+    const size_t loop_count = _loops.size();
+    if (SelectPolicy::RoundRobin == _select_policy)
+        return _next_index.fetch_add(1, std::memory_order_relaxed) % loop_count;
+
+    // 负载相同时从轮转位置开始选择, 避免总是选中第一个
+    const size_t start = _next_index.fetch_add(1, std::memory_order_relaxed);
+    size_t best = start % loop_count, best_load = SIZE_MAX;
+    for (size_t i = 0; i < loop_count; ++i)
+    {
+        const size_t index = (start + i) % loop_count;
+        const size_t load = _loops[index]->get_handler_count() +
+            _pending_counts[index].load(std::memory_order_relaxed);
+        if (load < best_load)
+        {
+            best = index;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+PollerBase* EventLoopGroupBase::select_loop() noexcept
+{
+    return _loops[select_index()];
+}
+
+PollerBase* EventLoopGroupBase::current_loop() const noexcept
+{
+    for (PollerBase *loop : _loops)
+    {
+        if (nullptr != loop && loop->is_in_io_thread())
+            return loop;
+    }
+    return nullptr;
+}
+
+void EventLoopGroupBase::dispatch(loop_task_type&& task) noexcept
+{
+    const size_t index = select_index();
+    PollerBase *loop = _loops[index];
+    std::atomic<size_t> *pending = &_pending_counts[index];
+    pending->fetch_add(1, std::memory_order_relaxed);
+    loop->run_later([=] {
+        task(loop);
+        pending->fetch_sub(1, std::memory_order_relaxed);
+    });
+}
+
+void EventLoopGroupBase::run_in_each(const loop_task_type& task) noexcept
+{
+    for (PollerBase *loop : _loops)
+        loop->run_later([=] { task(loop); });
+}
+
+void EventLoopGroupBase::loop_thread_main(size_t index, bool pin_thread) noexcept
+{
+    if (pin_thread)
+    {
+        const unsigned cpu_count = std::max<unsigned>(1, std::thread::hardware_concurrency());
+        if (!set_current_thread_affinity(index % cpu_count))
+            NUT_LOG_W(TAG, "failed to pin event loop %d to cpu", (int) index);
+    }
+
+    // NOTE poller 必须在其 IO 线程中创建
+    PollerBase *poller = create_poller();
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _loops[index] = poller;
+        ++_started_count;
+    }
+    _condition.notify_all();
+    if (nullptr == poller)
+        return;
+
+    while (!_stopping.load(std::memory_order_relaxed))
+    {
+        if (poll(poller, 1000) < 0)
+        {
+            NUT_LOG_E(TAG, "event loop %d poll failed, exit", (int) index);
+            break;
+        }
+    }
+
+    // NOTE 出错退出时, 等到 stop() 时再销毁 poller, 避免其他线程访问到已销毁的 poller
+    {
+        std::unique_lock<std::mutex> guard(_lock);
+        while (!_stopping.load(std::memory_order_relaxed))
+            _condition.wait(guard);
+    }
+
+    destroy_poller(poller);
+}
+
+}
@@ -0,0 +1,168 @@
+﻿
+#ifndef ___HEADFILE_E736AF37_F6D5_47DA_87BC_C727E3882325_
+#define ___HEADFILE_E736AF37_F6D5_47DA_87BC_C727E3882325_
+
+#include "../loofah_config.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+#include "poller_base.h"
+
+
+namespace loofah
+{
+
+/**
+ * 事件循环组, 每个事件循环运行在各自的线程中, 并拥有各自的 poller
+ *
+ * NOTE poller 的 IO 线程即为其构造线程, 故 poller 在各自的线程中创建和销毁
+ */
+class LOOFAH_API EventLoopGroupBase
+{
+public:
+    typedef std::function<void(PollerBase*)> loop_task_type;
+
+    /**
+     * 分派连接时选择事件循环的策略
+     */
+    enum class SelectPolicy
+    {
+        RoundRobin, // 轮流选择
+        LeastLoaded, // 选择已注册 handler 最少的事件循环
+    };
+
+public:
+    EventLoopGroupBase() = default;
+    virtual ~EventLoopGroupBase() noexcept;
+
+    /**
+     * 启动所有事件循环线程, 返回时所有 poller 已经创建完成
+     *
+     * @param loop_count 事件循环数, 0 表示与 CPU 核数相同
+     * @param pin_threads 是否将各线程绑定到不同的 CPU 上
+     */
+    bool start(size_t loop_count = 0, bool pin_threads = true) noexcept;
+
+    /**
+     * 停止并等待所有事件循环线程结束
+     *
+     * NOTE 不能从事件循环线程中调用
+     */
+    void stop() noexcept;
+
+    size_t size() const noexcept;
+
+    void set_select_policy(SelectPolicy policy) noexcept;
+
+    /**
+     * 按照策略选择一个事件循环
+     *
+     * NOTE 该方法可以从任意线程调用
+     */
+    PollerBase* select_loop() noexcept;
+
+    /**
+     * 当前线程所在的事件循环; 不在任何事件循环线程中则返回 nullptr
+     */
+    PollerBase* current_loop() const noexcept;
+
+    /**
+     * 按照策略选择一个事件循环, 并在其中异步执行任务
+     *
+     * NOTE 已分派但尚未执行的任务也会计入负载
+     */
+    void dispatch(loop_task_type&& task) noexcept;
+
+    /**
+     * 在每一个事件循环中异步执行任务, 例如配合 SO_REUSEPORT 在每个事件循环中
+     * 各自建立 acceptor
+     */
+    void run_in_each(const loop_task_type& task) noexcept;
+
+protected:
+    /**
+     * 在事件循环线程中创建、轮询、销毁 poller
+     */
+    virtual PollerBase* create_poller() noexcept = 0;
+    virtual int poll(PollerBase *poller, int timeout_ms) noexcept = 0;
+    virtual void destroy_poller(PollerBase *poller) noexcept = 0;
+
+    PollerBase* get_loop(size_t index) const noexcept;
+
+private:
+    EventLoopGroupBase(const EventLoopGroupBase&) = delete;
+    EventLoopGroupBase& operator=(const EventLoopGroupBase&) = delete;
+
+    void loop_thread_main(size_t index, bool pin_thread) noexcept;
+    size_t select_index() noexcept;
+
+private:
+    std::vector<std::thread> _threads;
+    std::vector<PollerBase*> _loops;
+
+    // 各事件循环已分派但尚未执行的任务数
+    std::unique_ptr<std::atomic<size_t>[]> _pending_counts;
+
+    SelectPolicy _select_policy = SelectPolicy::RoundRobin;
+    std::atomic<size_t> _next_index = ATOMIC_VAR_INIT(0);
+
+    std::mutex _lock;
+    std::condition_variable _condition;
+    size_t _started_count = 0;
+    std::atomic<bool> _stopping = ATOMIC_VAR_INIT(false);
+};
+
+/**
+ * @param POLLER Reactor 或者 Proactor
+ */
+template <typename POLLER>
+class EventLoopGroup : public EventLoopGroupBase
+{
+public:
+    virtual ~EventLoopGroup() noexcept override
+    {
+        // NOTE 需要在子类析构前停止, 否则事件循环线程会调用到纯虚函数
+        stop();
+    }
+
+    POLLER* select_loop() noexcept
+    {
+        return static_cast<POLLER*>(EventLoopGroupBase::select_loop());
+    }
+
+    POLLER* current_loop() const noexcept
+    {
+        return static_cast<POLLER*>(EventLoopGroupBase::current_loop());
+    }
+
+    POLLER* get_loop(size_t index) const noexcept
+    {
+        return static_cast<POLLER*>(EventLoopGroupBase::get_loop(index));
+    }
+
+protected:
+    virtual PollerBase* create_poller() noexcept override
+    {
+        return new POLLER;
+    }
+
+    virtual int poll(PollerBase *poller, int timeout_ms) noexcept override
+    {
+        return static_cast<POLLER*>(poller)->poll(timeout_ms);
+    }
+
+    virtual void destroy_poller(PollerBase *poller) noexcept override
+    {
+        delete static_cast<POLLER*>(poller);
+    }
+};
+
+}
+
+#endif
@@ -1,11 +1,17 @@
 ﻿
 #include "../loofah_config.h"
 
+#include <assert.h>
+#include <limits.h> // for INT_MAX
+#include <algorithm> // for std::min()
+
 #include <nut/logging/logger.h>
 
 #include "poller_base.h"
 
 
+#undef min
+
 #define TAG "loofah.poller_base"
 
 namespace loofah
@@ -16,63 +22,120 @@ PollerBase::PollerBase() noexcept
     _io_thread_tid = std::this_thread::get_id();
 }
 
-void PollerBase::add_later_task(task_type&& task) noexcept
+bool PollerBase::is_in_io_thread() const noexcept
 {
-    _later_tasks.eliminate_enqueue(std::forward<task_type>(task));
+    return _io_thread_tid == std::this_thread::get_id();
 }
 
-void PollerBase::add_later_task(const task_type& task) noexcept
+bool PollerBase::is_in_io_thread_and_not_polling() const noexcept
 {
-    _later_tasks.eliminate_enqueue(task);
+    return PollStage::NotPolling == _poll_stage && is_in_io_thread();
 }
 
-bool PollerBase::is_in_io_thread() const noexcept
+size_t PollerBase::get_handler_count() const noexcept
 {
-    return _io_thread_tid == std::this_thread::get_id();
+    return _handler_count.load(std::memory_order_relaxed);
 }
 
-bool PollerBase::is_in_io_thread_and_not_polling() const noexcept
+PollerBase::timer_id_type PollerBase::add_timer(uint64_t delay_ms, uint64_t period_ms,
+                                                timer_task_type&& task) noexcept
 {
-    return PollStage::NotPolling == _poll_stage && is_in_io_thread();
+    assert(is_in_io_thread());
+    return _timers.add_timer(delay_ms, period_ms, std::forward<timer_task_type>(task));
 }
 
-void PollerBase::run_later_tasks() noexcept
+bool PollerBase::reset_timer(timer_id_type id, uint64_t delay_ms) noexcept
+{
+    assert(is_in_io_thread());
+    return _timers.reset_timer(id, delay_ms);
+}
+
+bool PollerBase::cancel_timer(timer_id_type id) noexcept
+{
+    assert(is_in_io_thread());
+    return _timers.cancel_timer(id);
+}
+
+int PollerBase::get_poll_timeout(int timeout_ms) noexcept
+{
+    const int64_t idle_ms = _timers.get_idle_ms(TimerQueue::now_ms());
+    if (idle_ms < 0)
+        return timeout_ms;
+    if (timeout_ms >= 0 && timeout_ms <= idle_ms)
+        return timeout_ms;
+    return (int) std::min<int64_t>(idle_ms, INT_MAX);
+}
+
+void PollerBase::run_timers() noexcept
 {
     // NOTE This method can only be called from inside IO thread
     assert(is_in_io_thread_and_not_polling());
 
-    task_type task;
-    while (_later_tasks.eliminate_dequeue(&task))
-        task();
+    if (0 == _timers.size())
+        return;
+    _timers.run_expired(TimerQueue::now_ms());
 }
 
-void PollerBase::run_later(task_type&& task) noexcept
+void PollerBase::set_active_events_limit(size_t init_count, size_t max_count) noexcept
 {
-    const bool in_iothread = is_in_io_thread();
-    if (in_iothread && PollStage::NotPolling == _poll_stage)
-    {
-        task();
-        return;
-    }
+    assert(is_in_io_thread());
+    assert(0 < init_count && init_count <= max_count);
+    _active_events_count = init_count;
+    _max_active_events_count = max_count;
+}
 
-    add_later_task(std::forward<task_type>(task));
+size_t PollerBase::get_active_events_count() const noexcept
+{
+    return _active_events_count;
+}
 
-    if (!in_iothread)
-        wakeup_poll_wait();
+void PollerBase::set_accept_budget(size_t max_count) noexcept
+{
+    _accept_budget = max_count;
 }
 
-void PollerBase::run_later(const task_type& task) noexcept
+size_t PollerBase::get_accept_budget() const noexcept
 {
-    const bool in_iothread = is_in_io_thread();
-    if (in_iothread && PollStage::NotPolling == _poll_stage)
-    {
-        task();
+    return _accept_budget;
+}
+
+void PollerBase::adapt_active_events_count(int polled_count) noexcept
+{
+    if (polled_count <= 0 || (size_t) polled_count < _active_events_count ||
+        _active_events_count >= _max_active_events_count)
         return;
+
+    _active_events_count = std::min(_active_events_count * 2, _max_active_events_count);
+    NUT_LOG_D(TAG, "active events count grows to %d", (int) _active_events_count);
+}
+
+void PollerBase::run_later_tasks() noexcept
+{
+    // NOTE This method can only be called from inside IO thread
+    assert(is_in_io_thread_and_not_polling());
+
+    // NOTE 先清除标记再取任务, 之后入队的任务会重新唤醒 IO 线程
+    _later_tasks_signaled.store(false, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (size_t i = 0; i < LOOFAH_MAX_LATER_TASKS_PER_POLL; ++i)
+    {
+        TaskQueue::Node *node = _later_tasks.pop();
+        if (nullptr == node)
+            return;
+        node->run();
+        delete node;
     }
 
-    add_later_task(task);
+    // 可能还有剩余任务, 保证下次轮询不会阻塞
+    _later_tasks_signaled.store(true, std::memory_order_relaxed);
+    wakeup_poll_wait();
+}
 
-    if (!in_iothread)
+void PollerBase::signal_later_tasks() noexcept
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!_later_tasks_signaled.exchange(true, std::memory_order_relaxed))
         wakeup_poll_wait();
 }
 
@@ -7,8 +7,10 @@
 #include <vector>
 #include <functional>
 #include <thread>
+#include <atomic>
 
-#include <nut/threading/lockfree/concurrent_queue.h>
+#include "task_queue.h"
+#include "timer_queue.h"
 
 
 namespace loofah
@@ -18,6 +20,8 @@ class LOOFAH_API PollerBase
 {
 public:
     typedef std::function<void()> task_type;
+    typedef TimerQueue::timer_id_type timer_id_type;
+    typedef TimerQueue::timer_task_type timer_task_type;
 
 public:
     PollerBase() noexcept;
@@ -57,9 +61,24 @@ public:
 
     /**
      * 在事件循环线程且事件处理间隔中运行
+     *
+     * NOTE 从其他线程连续调用时, 只有任务队列由空变为非空时才唤醒 IO 线程
      */
-    void run_later(task_type&& task) noexcept;
-    void run_later(const task_type& task) noexcept;
+    template <typename TASK>
+    void run_later(TASK&& task) noexcept
+    {
+        const bool in_iothread = is_in_io_thread();
+        if (in_iothread && PollStage::NotPolling == _poll_stage)
+        {
+            task();
+            return;
+        }
+
+        add_later_task(std::forward<TASK>(task));
+
+        if (!in_iothread)
+            signal_later_tasks();
+    }
 
     /**
      * 如果 io 线程处于轮询等待状态(select() / WSAPoll() / kevent() / epoll_wait())
@@ -69,21 +88,104 @@ public:
      */
     virtual void wakeup_poll_wait() noexcept = 0;
 
+    /**
+     * 已注册的 handler 数量, 可作为负载参考
+     *
+     * NOTE 该方法可以从非 io 线程调用
+     */
+    size_t get_handler_count() const noexcept;
+
+    /**
+     * 添加定时器, 定时器在 IO 线程的轮询间隔中触发
+     *
+     * poll() 的等待时间不会超过最近的定时器到期时间, 所以不需要以固定周期轮询
+     *
+     * NOTE 定时器相关方法只能在 IO 线程中调用, 其他线程可以通过 run_later() 转发
+     *
+     * @param delay_ms 首次触发的延迟
+     * @param period_ms 重复触发的周期; 0 表示只触发一次
+     * @return 定时器 id, 不会是 LOOFAH_INVALID_TIMER_ID
+     */
+    timer_id_type add_timer(uint64_t delay_ms, uint64_t period_ms, timer_task_type&& task) noexcept;
+
+    /**
+     * 将定时器的下次触发时间推迟到 delay_ms 之后, 适用于空闲超时等频繁重置的场景
+     *
+     * @return 定时器已经触发或者已经取消时返回 false
+     */
+    bool reset_timer(timer_id_type id, uint64_t delay_ms) noexcept;
+
+    bool cancel_timer(timer_id_type id) noexcept;
+
+    /**
+     * 设置 epoll_wait() / kevent() 单次查询返回事件数的初始值和上限
+     *
+     * 某次查询返回的事件数达到当前值, 说明可能还有事件未取出, 则下次查询时倍增,
+     * 直到上限
+     *
+     * NOTE 该方法只能在 IO 线程中调用; Windows 及 io_uring 实现下无效
+     */
+    void set_active_events_limit(size_t init_count, size_t max_count) noexcept;
+
+    /**
+     * 当前 epoll_wait() / kevent() 单次查询返回事件数
+     */
+    size_t get_active_events_count() const noexcept;
+
+    /**
+     * 设置每次可接收事件最多接收的连接数, 剩余的留到下一轮 poll(), 避免大量
+     * 连接涌入时阻塞已建立连接的事件处理
+     *
+     * NOTE 0 表示不限制; Reactor 实现下达到上限后会多接收一个连接, 接收成功
+     *      才推迟到下一轮; Windows 的 Proactor 及 io_uring 实现下每次只接收一个
+     *      连接, 不受此限制
+     */
+    void set_accept_budget(size_t max_count) noexcept;
+    size_t get_accept_budget() const noexcept;
+
 protected:
     /**
-     * 运行并清空所有异步任务
+     * 运行异步任务, 单次最多运行 LOOFAH_MAX_LATER_TASKS_PER_POLL 个, 剩余的
+     * 留到下次轮询, 并保证下次轮询不会阻塞
      *
      * NOTE This method can only be called from inside IO thread
      */
     void run_later_tasks() noexcept;
 
+    /**
+     * 根据最近的定时器到期时间调整 poll() 的等待时间
+     *
+     * @param timeout_ms <0 表示无限等待
+     */
+    int get_poll_timeout(int timeout_ms) noexcept;
+
+    /**
+     * 触发所有到期的定时器
+     *
+     * NOTE This method can only be called from inside IO thread
+     */
+    void run_timers() noexcept;
+
     /**
      * 添加一个异步任务
      */
-    void add_later_task(task_type&& task) noexcept;
-    void add_later_task(const task_type& task) noexcept;
+    template <typename TASK>
+    void add_later_task(TASK&& task) noexcept
+    {
+        _later_tasks.push(std::forward<TASK>(task));
+    }
+
+    /**
+     * 根据单次查询返回的事件数调整下次查询的事件数
+     */
+    void adapt_active_events_count(int polled_count) noexcept;
 
 private:
+    /**
+     * 通知 IO 线程有新的异步任务; 已经通知过且 IO 线程尚未处理时不再重复唤醒
+     */
+    void signal_later_tasks() noexcept;
+
     PollerBase(const PollerBase&) = delete;
     PollerBase& operator=(const PollerBase&) = delete;
 
@@ -95,9 +197,23 @@ protected:
         NotPolling, // 处理其他任务
     } _poll_stage = PollStage::NotPolling;
 
+    // 由 register_handler() / unregister_handler() 维护
+    std::atomic<size_t> _handler_count = ATOMIC_VAR_INIT(0);
+
+    // epoll_wait() / kevent() 单次查询返回事件数
+    size_t _active_events_count = LOOFAH_INIT_ACTIVE_EVENTS;
+    size_t _max_active_events_count = LOOFAH_MAX_ACTIVE_EVENTS;
+
+    // 每次可接收事件最多接收的连接数
+    size_t _accept_budget = LOOFAH_DEFAULT_ACCEPT_BUDGET;
+
 private:
     std::thread::id _io_thread_tid;
-    nut::ConcurrentQueue<task_type> _later_tasks;
+    TaskQueue _later_tasks;
+    TimerQueue _timers;
+
+    // 已经唤醒 IO 线程, 但其尚未开始处理异步任务
+    std::atomic<bool> _later_tasks_signaled = ATOMIC_VAR_INIT(false);
 };
 
 }
@@ -0,0 +1,67 @@
+﻿
+#include "../loofah_config.h"
+
+#include <assert.h>
+
+#include "task_queue.h"
+
+
+namespace loofah
+{
+
+TaskQueue::TaskQueue() noexcept
+    : _head(&_stub), _tail(&_stub)
+{}
+
+TaskQueue::~TaskQueue() noexcept
+{
+    // 丢弃未执行的任务
+    Node *node = nullptr;
+    while (nullptr != (node = pop()))
+        delete node;
+}
+
+void TaskQueue::push_node(Node *node) noexcept
+{
+    assert(nullptr != node);
+    node->_next.store(nullptr, std::memory_order_relaxed);
+    Node *prev = _head.exchange(node, std::memory_order_acq_rel);
+    // NOTE 在此之前, 消费者看不到该节点及其之后的节点
+    prev->_next.store(node, std::memory_order_release);
+}
+
+TaskQueue::Node* TaskQueue::pop() noexcept
+{
+    Node *tail = _tail;
+    Node *next = tail->_next.load(std::memory_order_acquire);
+    if (&_stub == tail)
+    {
+        if (nullptr == next)
+            return nullptr;
+        _tail = next;
+        tail = next;
+        next = next->_next.load(std::memory_order_acquire);
+    }
+
+    if (nullptr != next)
+    {
+        _tail = next;
+        return tail;
+    }
+
+    // 'tail' 是最后一个节点, 或者有生产者正在入队
+    if (tail != _head.load(std::memory_order_acquire))
+        return nullptr;
+
+    // 放回 stub 节点后才能取出最后一个节点
+    push_node(&_stub);
+    next = tail->_next.load(std::memory_order_acquire);
+    if (nullptr != next)
+    {
+        _tail = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+}
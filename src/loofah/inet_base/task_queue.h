@@ -0,0 +1,96 @@
+﻿
+#ifndef ___HEADFILE_80C5B0C6_67FA_4335_8F41_AE5B5AF0AC51_
+#define ___HEADFILE_80C5B0C6_67FA_4335_8F41_AE5B5AF0AC51_
+
+#include "../loofah_config.h"
+
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+
+namespace loofah
+{
+
+/**
+ * 多生产者、单消费者的无锁任务队列, 基于 Dmitry Vyukov 的 intrusive MPSC 算法
+ *
+ * 任务对象直接构造在队列节点中, 入队只需要一次内存分配, 没有 std::function 额外
+ * 的堆分配
+ *
+ * NOTE push() 可以从任意线程调用; pop() 只能在同一个消费者线程中调用
+ */
+class LOOFAH_API TaskQueue
+{
+public:
+    class LOOFAH_API Node
+    {
+        friend class TaskQueue;
+
+    public:
+        Node() = default;
+        virtual ~Node() = default;
+
+        virtual void run() noexcept
+        {}
+
+    private:
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+    private:
+        std::atomic<Node*> _next = ATOMIC_VAR_INIT(nullptr);
+    };
+
+private:
+    template <typename TASK>
+    class TaskNode : public Node
+    {
+    public:
+        template <typename T>
+        explicit TaskNode(T&& task) noexcept
+            : _task(std::forward<T>(task))
+        {}
+
+        virtual void run() noexcept override
+        {
+            _task();
+        }
+
+    private:
+        TASK _task;
+    };
+
+public:
+    TaskQueue() noexcept;
+    ~TaskQueue() noexcept;
+
+    template <typename TASK>
+    void push(TASK&& task) noexcept
+    {
+        typedef typename std::decay<TASK>::type task_type;
+        push_node(new TaskNode<task_type>(std::forward<TASK>(task)));
+    }
+
+    /**
+     * 取出一个节点, 由调用者负责 run() 和 delete
+     *
+     * @return 队列为空, 或者生产者尚未完成入队时返回 nullptr
+     */
+    Node* pop() noexcept;
+
+private:
+    TaskQueue(const TaskQueue&) = delete;
+    TaskQueue& operator=(const TaskQueue&) = delete;
+
+    void push_node(Node *node) noexcept;
+
+private:
+    std::atomic<Node*> _head; // 生产者端
+    Node *_tail = nullptr; // 消费者端
+    Node _stub;
+};
+
+}
+
+#endif
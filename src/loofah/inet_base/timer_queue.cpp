@@ -0,0 +1,162 @@
+﻿
+#include "../loofah_config.h"
+
+#include <assert.h>
+#include <algorithm> // for std::push_heap(), std::pop_heap()
+#include <chrono>
+
+#include "timer_queue.h"
+
+
+// 失效的堆元素超过该数目, 并且多于有效定时器数目时重建堆
+#define COMPACT_THRESHOLD 64
+
+namespace loofah
+{
+
+namespace
+{
+
+struct LaterDeadline
+{
+    template <typename T>
+    bool operator()(const T& x, const T& y) const noexcept
+    {
+        return x.deadline > y.deadline;
+    }
+};
+
+}
+
+uint64_t TimerQueue::now_ms() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TimerQueue::timer_id_type TimerQueue::add_timer(uint64_t delay_ms, uint64_t period_ms,
+                                                timer_task_type&& task) noexcept
+{
+    assert(task);
+
+    timer_id_type id = ++_next_id;
+    if (LOOFAH_INVALID_TIMER_ID == id)
+        id = ++_next_id;
+
+    const uint64_t deadline = now_ms() + delay_ms;
+    Timer& timer = _timers[id];
+    timer.deadline = deadline;
+    timer.period = period_ms;
+    timer.task = std::move(task);
+    push_heap_entry(deadline, id);
+    return id;
+}
+
+bool TimerQueue::reset_timer(timer_id_type id, uint64_t delay_ms) noexcept
+{
+    std::unordered_map<timer_id_type, Timer>::iterator iter = _timers.find(id);
+    if (iter == _timers.end())
+        return false;
+
+    // NOTE 旧的堆元素因 deadline 不匹配而失效
+    const uint64_t deadline = now_ms() + delay_ms;
+    if (iter->second.deadline == deadline)
+        return true;
+    iter->second.deadline = deadline;
+    push_heap_entry(deadline, id);
+    return true;
+}
+
+bool TimerQueue::cancel_timer(timer_id_type id) noexcept
+{
+    return _timers.erase(id) > 0;
+}
+
+size_t TimerQueue::size() const noexcept
+{
+    return _timers.size();
+}
+
+int64_t TimerQueue::get_idle_ms(uint64_t now) noexcept
+{
+    pop_stale_entries();
+    if (_heap.empty())
+        return -1;
+
+    const uint64_t deadline = _heap.front().deadline;
+    return deadline > now ? (int64_t) (deadline - now) : 0;
+}
+
+void TimerQueue::run_expired(uint64_t now) noexcept
+{
+    while (!_heap.empty() && _heap.front().deadline <= now)
+    {
+        const HeapEntry entry = _heap.front();
+        std::pop_heap(_heap.begin(), _heap.end(), LaterDeadline());
+        _heap.pop_back();
+
+        std::unordered_map<timer_id_type, Timer>::iterator iter = _timers.find(entry.id);
+        if (iter == _timers.end() || iter->second.deadline != entry.deadline)
+            continue; // 已取消或者已重置
+
+        // NOTE 回调中可能增删定时器, 导致迭代器失效, 故先将任务移出
+        timer_task_type task;
+        if (0 == iter->second.period)
+        {
+            task = std::move(iter->second.task);
+            _timers.erase(iter);
+            task(entry.id);
+            continue;
+        }
+
+        const uint64_t deadline = now + iter->second.period;
+        iter->second.deadline = deadline;
+        push_heap_entry(deadline, entry.id);
+        task = std::move(iter->second.task);
+        task(entry.id);
+
+        iter = _timers.find(entry.id);
+        if (iter != _timers.end())
+            iter->second.task = std::move(task);
+    }
+
+    if (_heap.size() > COMPACT_THRESHOLD + 2 * _timers.size())
+        compact();
+}
+
+void TimerQueue::push_heap_entry(uint64_t deadline, timer_id_type id) noexcept
+{
+    HeapEntry entry;
+    entry.deadline = deadline;
+    entry.id = id;
+    _heap.push_back(entry);
+    std::push_heap(_heap.begin(), _heap.end(), LaterDeadline());
+}
+
+void TimerQueue::pop_stale_entries() noexcept
+{
+    while (!_heap.empty())
+    {
+        const HeapEntry& entry = _heap.front();
+        std::unordered_map<timer_id_type, Timer>::const_iterator iter = _timers.find(entry.id);
+        if (iter != _timers.end() && iter->second.deadline == entry.deadline)
+            return;
+        std::pop_heap(_heap.begin(), _heap.end(), LaterDeadline());
+        _heap.pop_back();
+    }
+}
+
+void TimerQueue::compact() noexcept
+{
+    _heap.clear();
+    for (const std::pair<const timer_id_type, Timer>& kv : _timers)
+    {
+        HeapEntry entry;
+        entry.deadline = kv.second.deadline;
+        entry.id = kv.first;
+        _heap.push_back(entry);
+    }
+    std::make_heap(_heap.begin(), _heap.end(), LaterDeadline());
+}
+
+}
@@ -0,0 +1,96 @@
+﻿
+#ifndef ___HEADFILE_A9B88A07_259F_4612_BB1F_8886029492BD_
+#define ___HEADFILE_A9B88A07_259F_4612_BB1F_8886029492BD_
+
+#include "../loofah_config.h"
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+
+#define LOOFAH_INVALID_TIMER_ID 0
+
+namespace loofah
+{
+
+/**
+ * 基于最小堆的定时器队列
+ *
+ * 取消、重置定时器时不立即从堆中删除, 而是在到期时跳过失效的堆元素; 失效元素
+ * 过多时重建堆
+ *
+ * NOTE 非线程安全, 由 PollerBase 在 IO 线程中使用
+ */
+class LOOFAH_API TimerQueue
+{
+public:
+    typedef uint64_t timer_id_type;
+    typedef std::function<void(timer_id_type)> timer_task_type;
+
+public:
+    TimerQueue() = default;
+
+    /**
+     * 单调递增的毫秒时间
+     */
+    static uint64_t now_ms() noexcept;
+
+    /**
+     * @param delay_ms 首次触发的延迟
+     * @param period_ms 重复触发的周期; 0 表示只触发一次
+     */
+    timer_id_type add_timer(uint64_t delay_ms, uint64_t period_ms, timer_task_type&& task) noexcept;
+
+    /**
+     * 重新设置下次触发时间为 delay_ms 之后
+     *
+     * @return 定时器不存在(已触发或者已取消)时返回 false
+     */
+    bool reset_timer(timer_id_type id, uint64_t delay_ms) noexcept;
+
+    bool cancel_timer(timer_id_type id) noexcept;
+
+    size_t size() const noexcept;
+
+    /**
+     * 距离最近的定时器到期的毫秒数; 没有定时器时返回 -1
+     */
+    int64_t get_idle_ms(uint64_t now) noexcept;
+
+    /**
+     * 触发所有到期的定时器
+     */
+    void run_expired(uint64_t now) noexcept;
+
+private:
+    TimerQueue(const TimerQueue&) = delete;
+    TimerQueue& operator=(const TimerQueue&) = delete;
+
+    void push_heap_entry(uint64_t deadline, timer_id_type id) noexcept;
+    void pop_stale_entries() noexcept;
+    void compact() noexcept;
+
+private:
+    struct Timer
+    {
+        uint64_t deadline;
+        uint64_t period;
+        timer_task_type task;
+    };
+
+    struct HeapEntry
+    {
+        uint64_t deadline;
+        timer_id_type id;
+    };
+
+    std::unordered_map<timer_id_type, Timer> _timers;
+    std::vector<HeapEntry> _heap;
+    timer_id_type _next_id = LOOFAH_INVALID_TIMER_ID;
+};
+
+}
+
+#endif
@@ -14,6 +14,11 @@
 #   include <fcntl.h> // for fcntl()
 #endif
 
+#if NUT_PLATFORM_OS_LINUX
+#   include <pthread.h> // for ::pthread_setaffinity_np()
+#   include <sched.h> // for cpu_set_t
+#endif
+
 #include <nut/logging/logger.h>
 
 #include "utils.h"
@@ -271,4 +276,35 @@ LOOFAH_API int socketpair(int family, int type, int protocol, socket_t fds[2]) n
 }
 #endif
 
+
+bool set_current_thread_affinity(unsigned cpu_index) noexcept
+{
+#if NUT_PLATFORM_OS_WINDOWS
+    if (cpu_index >= sizeof(DWORD_PTR) * 8)
+        return false;
+    if (0 == ::SetThreadAffinityMask(::GetCurrentThread(), ((DWORD_PTR) 1) << cpu_index))
+    {
+        NUT_LOG_E(TAG, "failed to call SetThreadAffinityMask() with GetLastError() %d", ::GetLastError());
+        return false;
+    }
+    return true;
+#elif NUT_PLATFORM_OS_LINUX
+    if (cpu_index >= CPU_SETSIZE)
+        return false;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu_index, &cpuset);
+    const int rs = ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuset), &cpuset);
+    if (0 != rs)
+    {
+        NUT_LOG_E(TAG, "failed to call pthread_setaffinity_np() with return %d", rs);
+        return false;
+    }
+    return true;
+#else
+    UNUSED(cpu_index);
+    return false;
+#endif
+}
+
 }
@@ -41,6 +41,16 @@ LOOFAH_API void shutdown_network() noexcept;
 LOOFAH_API int socketpair(int family, int type, int protocol, socket_t fds[2]) noexcept;
 #endif
 
+/**
+ * 将当前线程绑定到指定 CPU 上
+ *
+ * NOTE macOS 不支持将线程绑定到指定 CPU, 总是返回 false
+ *
+ * @param cpu_index CPU 序号, 从 0 开始
+ * @return 成功则返回 true
+ */
+LOOFAH_API bool set_current_thread_affinity(unsigned cpu_index) noexcept;
+
 }
 
 #endif
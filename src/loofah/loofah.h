@@ -8,7 +8,10 @@
 #include "inet_base/inet_addr.h"
 #include "inet_base/sock_operation.h"
 #include "inet_base/sock_stream.h"
+#include "inet_base/task_queue.h"
+#include "inet_base/timer_queue.h"
 #include "inet_base/poller_base.h"
+#include "inet_base/event_loop_group.h"
 #include "inet_base/channel.h"
 #include "inet_base/utils.h"
 #include "inet_base/error.h"
@@ -30,6 +33,9 @@
 
 // package channel
 #include "package/package.h"
+#include "package/package_pool.h"
+#include "package/file_region.h"
+#include "package/write_queue.h"
 #include "package/package_channel_base.h"
 #include "package/react_package_channel.h"
 #include "package/proact_package_channel.h"
@@ -24,15 +24,74 @@
 typedef int socklen_t;
 #endif
 
-// epoll_wait() / kevent() 单次查询最多返回事件数
-#define LOOFAH_MAX_ACTIVE_EVENTS 64
+// epoll_wait() / kevent() 单次查询返回事件数的默认初始值和上限
+// NOTE 某次查询返回的事件数达到当前值时, 自动倍增直到上限; 可以通过
+//      PollerBase::set_active_events_limit() 在运行时修改
+#define LOOFAH_INIT_ACTIVE_EVENTS 64
+#define LOOFAH_MAX_ACTIVE_EVENTS 4096
 
-// 读操作的初始预分配 package payload 大小
+// 每次轮询最多运行的异步任务数, 避免大量跨线程任务阻塞 IO 事件处理
+#define LOOFAH_MAX_LATER_TASKS_PER_POLL 1024
+
+// 读操作的初始预分配 package payload 大小, 之后根据实际读取的字节数在最小值和
+// 最大值之间自适应调整
 #define LOOFAH_INIT_READ_PKG_SIZE 1024
+#define LOOFAH_MIN_READ_PKG_SIZE 256
+#define LOOFAH_MAX_READ_PKG_SIZE (64 * 1024)
+
+// 连续多少次读取的字节数不足预分配大小的一半时, 缩小预分配大小
+#define LOOFAH_READ_PKG_SHRINK_THRESHOLD 2
+
+// reactor 内共享读缓冲的大小, 参见 ReactPackageChannel::set_shared_read_buffer()
+#define LOOFAH_SHARED_READ_BUFFER_SIZE (64 * 1024)
+
+// 单次 writev() 最多合并的 package 数, 以及最多写出的字节数(至少一个 package)
+// NOTE package 数不能超过系统的 IOV_MAX (Linux、macOS 下均为 1024)
+#define LOOFAH_MAX_WRITE_BUFS 1024
+#define LOOFAH_MAX_WRITE_BYTES (1024 * 1024)
+
+// 每次可接收事件默认最多接收的连接数, 0 表示不限制
+#define LOOFAH_DEFAULT_ACCEPT_BUDGET 64
+
+// reactor 中每个 handler 单轮 poll() 默认最多读取的字节数, 0 表示不限制
+#define LOOFAH_DEFAULT_READ_QUOTA (256 * 1024)
+
+// 模拟 proactor 中每个就绪事件最多连续完成的读/写请求数
+#define LOOFAH_MAX_COMPLETIONS_PER_EVENT 16
+
+// package 写队列的内联容量, 超过后才在堆上分配, 必须是 2 的幂
+#define LOOFAH_WRITE_QUEUE_INLINE_CAPACITY 4
+
+// 默认写队列高低水位(字节数), 参见 PackageChannelBase::set_write_watermarks()
+#define LOOFAH_DEFAULT_WRITE_HIGH_WATERMARK (4 * 1024 * 1024)
+#define LOOFAH_DEFAULT_WRITE_LOW_WATERMARK (1024 * 1024)
 
 // 默认最大 package payload 大小
 #define LOOFAH_DEFAULT_MAX_PKG_SIZE (64 * 1024 * 1024)
 
+// package 池中每个大小级别最多缓存的空闲 package 数
+#define LOOFAH_PACKAGE_POOL_MAX_CACHED 256
+
+// proactor 的 IORequest 池中每个桶最多缓存的空闲请求数
+#define LOOFAH_IO_REQUEST_POOL_MAX_CACHED 256
+
+// Linux 下 Proactor 是否使用 io_uring 实现
+// NOTE 运行时内核不支持(Linux 5.7 之前, 缺少 IORING_FEAT_FAST_POLL)则自动退回到
+//      epoll 模拟实现
+#if !defined(LOOFAH_USE_IO_URING)
+#   if NUT_PLATFORM_OS_LINUX && defined(__has_include)
+#       if __has_include(<linux/io_uring.h>)
+#           define LOOFAH_USE_IO_URING 1
+#       endif
+#   endif
+#   if !defined(LOOFAH_USE_IO_URING)
+#       define LOOFAH_USE_IO_URING 0
+#   endif
+#endif
+
+// io_uring 提交队列大小
+#define LOOFAH_IO_URING_ENTRIES 1024
+
 // 强制关闭连接延时(毫秒)
 // <0 表示不强制关闭, 0 表示立即关闭(可能会丢失未写完的数据), >0 表示超时强制关闭
 #define LOOFAH_FORCE_CLOSE_DELAY (20 * 1000)
@@ -0,0 +1,150 @@
+﻿
+#include "../loofah_config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h> // for ::strerror()
+#include <algorithm> // for std::min()
+
+#include <nut/platform/platform.h>
+
+#if NUT_PLATFORM_OS_WINDOWS
+#   include <io.h> // for ::_lseeki64(), ::_read() and ::_close()
+#elif NUT_PLATFORM_OS_MACOS
+#   include <unistd.h> // for ::pread() and ::close()
+#   include <sys/types.h>
+#   include <sys/socket.h>
+#   include <sys/uio.h> // for ::sendfile()
+#else
+#   include <unistd.h> // for ::pread() and ::close()
+#   include <sys/sendfile.h> // for ::sendfile()
+#endif
+
+#include <nut/logging/logger.h>
+
+#include "../inet_base/error.h"
+#include "file_region.h"
+
+
+#define TAG "loofah.package.file_region"
+
+namespace loofah
+{
+
+FileRegion::FileRegion(int fd, int64_t offset, size_t len, bool close_fd) noexcept
+    : _fd(fd), _offset(offset), _remaining(len), _close_fd(close_fd)
+{
+    assert(fd >= 0 && offset >= 0);
+}
+
+FileRegion::~FileRegion() noexcept
+{
+    if (!_close_fd || _fd < 0)
+        return;
+
+#if NUT_PLATFORM_OS_WINDOWS
+    ::_close(_fd);
+#else
+    if (0 != ::close(_fd))
+        LOOFAH_LOG_FD_ERRNO(close, _fd);
+#endif
+    _fd = -1;
+}
+
+int FileRegion::get_fd() const noexcept
+{
+    return _fd;
+}
+
+int64_t FileRegion::get_offset() const noexcept
+{
+    return _offset;
+}
+
+size_t FileRegion::remaining_size() const noexcept
+{
+    return _remaining;
+}
+
+void FileRegion::skip(size_t len) noexcept
+{
+    assert(len <= _remaining);
+    _offset += len;
+    _remaining -= len;
+}
+
+ssize_t FileRegion::read(void *buf, size_t len) noexcept
+{
+    assert(nullptr != buf);
+
+    len = std::min(len, _remaining);
+#if NUT_PLATFORM_OS_WINDOWS
+    if (::_lseeki64(_fd, _offset, SEEK_SET) < 0)
+    {
+        NUT_LOG_E(TAG, "failed to call _lseeki64() with fd %d, errno %d", _fd, errno);
+        return LOOFAH_ERR_UNKNOWN;
+    }
+    const ssize_t rs = ::_read(_fd, buf, (unsigned) len);
+#else
+    const ssize_t rs = ::pread(_fd, buf, len, (off_t) _offset);
+#endif
+    if (rs < 0)
+    {
+        NUT_LOG_E(TAG, "failed to read file, fd %d, errno %d: %s", _fd, errno, ::strerror(errno));
+        return LOOFAH_ERR_UNKNOWN;
+    }
+    else if (0 == rs && len > 0)
+    {
+        NUT_LOG_E(TAG, "file truncated, fd %d, offset %lld", _fd, (long long) _offset);
+        return LOOFAH_ERR_UNKNOWN;
+    }
+    return rs;
+}
+
+ssize_t FileRegion::send_to(socket_t socket_fd, size_t max_len) noexcept
+{
+    const size_t len = std::min(max_len, _remaining);
+    if (0 == len)
+        return 0;
+
+#if NUT_PLATFORM_OS_WINDOWS
+    char buf[16 * 1024];
+    const ssize_t readed = read(buf, std::min(len, sizeof(buf)));
+    if (readed <= 0)
+        return readed;
+    return SockOperation::write(socket_fd, buf, readed);
+#elif NUT_PLATFORM_OS_MACOS
+    off_t sent = (off_t) len;
+    const int rs = ::sendfile(_fd, socket_fd, (off_t) _offset, &sent, nullptr, 0);
+    if (0 == rs)
+    {
+        if (0 == sent)
+        {
+            NUT_LOG_E(TAG, "file truncated, fd %d, offset %lld", _fd, (long long) _offset);
+            return LOOFAH_ERR_UNKNOWN;
+        }
+        return sent;
+    }
+    // NOTE 非阻塞 socket 返回 EAGAIN 时, 可能已经发送了部分数据
+    if (EAGAIN == errno || EWOULDBLOCK == errno)
+        return sent > 0 ? (ssize_t) sent : LOOFAH_ERR_WOULD_BLOCK;
+    LOOFAH_LOG_FD_ERRNO(sendfile, socket_fd);
+    return from_errno(errno);
+#else
+    off_t offset = (off_t) _offset;
+    const ssize_t rs = ::sendfile(socket_fd, _fd, &offset, len);
+    if (rs > 0)
+        return rs;
+    if (0 == rs)
+    {
+        NUT_LOG_E(TAG, "file truncated, fd %d, offset %lld", _fd, (long long) _offset);
+        return LOOFAH_ERR_UNKNOWN;
+    }
+    if (EAGAIN == errno || EWOULDBLOCK == errno)
+        return LOOFAH_ERR_WOULD_BLOCK;
+    LOOFAH_LOG_FD_ERRNO(sendfile, socket_fd);
+    return from_errno(errno);
+#endif
+}
+
+}
@@ -0,0 +1,78 @@
+﻿
+#ifndef ___HEADFILE_62602986_9F55_4795_981C_D73A176CCD8E_
+#define ___HEADFILE_62602986_9F55_4795_981C_D73A176CCD8E_
+
+#include "../loofah_config.h"
+
+#include <stdint.h>
+
+#include <nut/platform/int_type.h> // for ssize_t
+#include <nut/rc/rc_ptr.h>
+
+#include "../inet_base/sock_operation.h"
+
+
+namespace loofah
+{
+
+/**
+ * 待发送的一段文件内容, 参见 PackageChannelBase::send_file()
+ */
+class LOOFAH_API FileRegion
+{
+    NUT_REF_COUNTABLE
+
+public:
+    /**
+     * @param fd 文件描述符
+     * @param offset 起始偏移
+     * @param len 字节数
+     * @param close_fd 析构时是否关闭 fd
+     */
+    FileRegion(int fd, int64_t offset, size_t len, bool close_fd) noexcept;
+    virtual ~FileRegion() noexcept;
+
+    int get_fd() const noexcept;
+    int64_t get_offset() const noexcept;
+
+    /**
+     * 尚未发送的字节数
+     */
+    size_t remaining_size() const noexcept;
+
+    /**
+     * 标记已发送 len 字节
+     */
+    void skip(size_t len) noexcept;
+
+    /**
+     * 从当前位置起读取文件内容, 不改变当前位置
+     *
+     * @return >0 读到的字节数; <0 错误码; 文件被截断时返回 LOOFAH_ERR_UNKNOWN
+     */
+    ssize_t read(void *buf, size_t len) noexcept;
+
+    /**
+     * 从当前位置起直接将文件内容发送到 socket, 不改变当前位置
+     *
+     * Linux 下使用 sendfile(), macOS 下使用 sendfile() 的 BSD 形式, 数据不经过
+     * 用户态; Windows 下退化为 read() + send()
+     *
+     * @return >=0 发送的字节数; <0 错误码, 如 LOOFAH_ERR_WOULD_BLOCK
+     */
+    ssize_t send_to(socket_t socket_fd, size_t max_len) noexcept;
+
+private:
+    FileRegion(const FileRegion&) = delete;
+    FileRegion& operator=(const FileRegion&) = delete;
+
+private:
+    int _fd = -1;
+    int64_t _offset = 0;
+    size_t _remaining = 0;
+    bool _close_fd = false;
+};
+
+}
+
+#endif
@@ -3,14 +3,19 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h> // For ::memcpy()
+#include <new> // For placement new
+#include <atomic>
 #include <algorithm> // For std::min()
 
+#include <nut/rc/rc_new.h>
+
 #include <nut/platform/endian.h>
 
 #include "package.h"
 
 
 #undef min
+#undef max
 
 #define VALIDATE_MEMBERS() \
     assert((nullptr == _buffer && 0 == _capacity && sizeof(header_type) == _read_index && sizeof(header_type) == _write_index) || \
@@ -19,20 +24,91 @@
 namespace loofah
 {
 
+namespace
+{
+
+/**
+ * 缓冲区前面的引用计数, 与数据在同一块内存中分配
+ */
+struct BufferHeader
+{
+    std::atomic<int> ref_count;
+};
+
+BufferHeader* get_buffer_header(const uint8_t *buf) noexcept
+{
+    assert(nullptr != buf);
+    return ((BufferHeader*) buf) - 1;
+}
+
+uint8_t* buffer_alloc(size_t cap) noexcept
+{
+    BufferHeader *header = (BufferHeader*) ::malloc(sizeof(BufferHeader) + cap);
+    assert(nullptr != header);
+    new (&header->ref_count) std::atomic<int>(1);
+    return (uint8_t*) (header + 1);
+}
+
+uint8_t* buffer_realloc(uint8_t *buf, size_t new_cap) noexcept
+{
+    if (nullptr == buf)
+        return buffer_alloc(new_cap);
+
+    BufferHeader *header = get_buffer_header(buf);
+    assert(1 == header->ref_count.load(std::memory_order_relaxed));
+    header = (BufferHeader*) ::realloc(header, sizeof(BufferHeader) + new_cap);
+    assert(nullptr != header);
+    return (uint8_t*) (header + 1);
+}
+
+void buffer_add_ref(uint8_t *buf) noexcept
+{
+    get_buffer_header(buf)->ref_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void buffer_release(uint8_t *buf) noexcept
+{
+    BufferHeader *header = get_buffer_header(buf);
+    if (1 == header->ref_count.fetch_sub(1, std::memory_order_acq_rel))
+    {
+        header->ref_count.~atomic();
+        ::free(header);
+    }
+}
+
+bool buffer_is_shared(const uint8_t *buf) noexcept
+{
+    return nullptr != buf && get_buffer_header(buf)->ref_count.load(std::memory_order_acquire) > 1;
+}
+
+}
+
 Package::Package(size_t init_cap) noexcept
 {
-    _buffer = (uint8_t*) ::malloc(sizeof(header_type) + init_cap);
+    _buffer = buffer_alloc(sizeof(header_type) + init_cap);
     _capacity = sizeof(header_type) + init_cap;
 }
 
 Package::Package(const void *buf, size_t len) noexcept
 {
-    _buffer = (uint8_t*) ::malloc(sizeof(header_type) + len);
+    _buffer = buffer_alloc(sizeof(header_type) + len);
     ::memcpy(_buffer + sizeof(header_type), buf, len);
     _capacity = sizeof(header_type) + len;
     _write_index = sizeof(header_type) + len;
 }
 
+Package::Package(const Package& parent, size_t offset, size_t len) noexcept
+    : _little_endian(parent._little_endian)
+{
+    assert(nullptr != parent._buffer && offset + len <= parent.readable_size());
+    _buffer = parent._buffer;
+    buffer_add_ref(_buffer);
+    _read_index = parent._read_index + offset;
+    _write_index = _read_index + len;
+    // NOTE 之后的数据属于其他 Package, 不可写入
+    _capacity = _write_index;
+}
+
 Package::~Package() noexcept
 {
     clear();
@@ -51,13 +127,58 @@ void Package::set_little_endian(bool le) noexcept
 void Package::clear() noexcept
 {
     if (nullptr != _buffer)
-        ::free(_buffer);
+        buffer_release(_buffer);
     _buffer = nullptr;
     _capacity = 0;
     _read_index = sizeof(header_type);
     _write_index = sizeof(header_type);
 }
 
+void Package::reset() noexcept
+{
+    // 共享的缓冲区不能复用
+    if (is_shared())
+        clear();
+    _read_index = sizeof(header_type);
+    _write_index = sizeof(header_type);
+    _little_endian = false;
+}
+
+size_t Package::capacity() const noexcept
+{
+    if (_capacity <= sizeof(header_type))
+        return 0;
+    return _capacity - sizeof(header_type);
+}
+
+nut::rc_ptr<Package> Package::slice(size_t offset, size_t len) noexcept
+{
+    return nut::rc_new<Package>(*this, offset, len);
+}
+
+bool Package::is_shared() const noexcept
+{
+    return buffer_is_shared(_buffer);
+}
+
+void Package::detach() noexcept
+{
+    VALIDATE_MEMBERS();
+
+    if (!is_shared())
+        return;
+
+    const size_t data_size = _write_index - _read_index;
+    const size_t new_cap = std::max(_capacity, sizeof(header_type) + data_size);
+    uint8_t *new_buf = buffer_alloc(new_cap);
+    ::memcpy(new_buf + sizeof(header_type), _buffer + _read_index, data_size);
+    buffer_release(_buffer);
+    _buffer = new_buf;
+    _capacity = new_cap;
+    _read_index = sizeof(header_type);
+    _write_index = sizeof(header_type) + data_size;
+}
+
 size_t Package::readable_size() const noexcept
 {
     VALIDATE_MEMBERS();
@@ -114,7 +235,8 @@ void Package::ensure_writable_size(size_t write_size) noexcept
 
     const size_t data_size = _write_index - _read_index;
     const size_t min_cap = sizeof(header_type) + data_size + write_size;
-    if (_capacity >= min_cap)
+    const bool shared = is_shared();
+    if (_capacity >= min_cap && !shared)
     {
         assert(nullptr != _buffer);
         ::memmove(_buffer + sizeof(header_type), _buffer + _read_index, data_size);
@@ -127,17 +249,18 @@ void Package::ensure_writable_size(size_t write_size) noexcept
     if (new_cap < min_cap)
         new_cap = min_cap;
 
-    if (_read_index <= sizeof(header_type))
+    if (_read_index <= sizeof(header_type) && !shared)
     {
-        _buffer = (uint8_t*) ::realloc(_buffer, new_cap);
+        _buffer = buffer_realloc(_buffer, new_cap);
         _capacity = new_cap;
     }
     else
     {
-        uint8_t *new_buf = (uint8_t*) ::malloc(new_cap);
-        assert(nullptr != new_buf && nullptr != _buffer);
+        // NOTE 共享的缓冲区在此处完成 copy-on-write
+        assert(nullptr != _buffer);
+        uint8_t *new_buf = buffer_alloc(new_cap);
         ::memcpy(new_buf + sizeof(header_type), _buffer + _read_index, data_size);
-        ::free(_buffer);
+        buffer_release(_buffer);
         _buffer = new_buf;
         _capacity = new_cap;
         _read_index = sizeof(header_type);
@@ -161,9 +284,14 @@ void Package::raw_pack() noexcept
 
     if (nullptr == _buffer)
     {
-        _buffer = (uint8_t*) ::malloc(sizeof(header_type));
+        _buffer = buffer_alloc(sizeof(header_type));
         _capacity = sizeof(header_type);
     }
+    else
+    {
+        // NOTE header 位置可能属于共享该缓冲区的其他 Package
+        detach();
+    }
 
     header_type *pheader = (header_type*)(_buffer + _read_index - sizeof(header_type));
     *pheader = htobe32(readable_size());
@@ -176,10 +304,23 @@ Package::header_type Package::header_betoh(header_type header) noexcept
     return be32toh(header);
 }
 
+Package::header_type Package::header_htobe(header_type header) noexcept
+{
+    assert(sizeof(header) == 4);
+    return htobe32(header);
+}
+
 void Package::raw_rewind() noexcept
 {
     VALIDATE_MEMBERS();
     assert(nullptr != _buffer);
+    if (is_shared())
+    {
+        const size_t cap = _capacity;
+        clear();
+        _buffer = buffer_alloc(cap);
+        _capacity = cap;
+    }
     _read_index = 0;
     _write_index = 0;
 }
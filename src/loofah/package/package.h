@@ -4,6 +4,7 @@
 
 #include "../loofah_config.h"
 
+#include <nut/rc/rc_ptr.h>
 #include <nut/container/bytestream/input_stream.h>
 #include <nut/container/bytestream/output_stream.h>
 
@@ -11,6 +12,12 @@
 namespace loofah
 {
 
+/**
+ * 数据包
+ *
+ * NOTE 缓冲区带有引用计数, 可以通过 slice() 在多个 Package 之间共享而不拷贝;
+ *      共享状态下的写操作会先拷贝出独立的缓冲区(copy-on-write)
+ */
 class LOOFAH_API Package : public nut::InputStream, public nut::OutputStream
 {
     NUT_REF_COUNTABLE_OVERRIDE
@@ -28,6 +35,26 @@ public:
 
     void clear() noexcept;
 
+    /**
+     * 清空数据, 但保留已分配的缓冲区
+     */
+    void reset() noexcept;
+
+    /**
+     * 已分配的 payload 容量
+     */
+    size_t capacity() const noexcept;
+
+    /**
+     * 创建一个共享缓冲区的 Package, 其数据为当前可读数据中 [offset, offset + len) 部分
+     */
+    nut::rc_ptr<Package> slice(size_t offset, size_t len) noexcept;
+
+    /**
+     * 缓冲区是否与其他 Package 共享
+     */
+    bool is_shared() const noexcept;
+
     virtual size_t readable_size() const noexcept override;
     const void* readable_data() const noexcept;
     virtual void skip_read(size_t len) noexcept override;
@@ -49,15 +76,31 @@ public:
      */
     static header_type header_betoh(header_type header) noexcept;
 
+    /**
+     * header host endian to big endian
+     */
+    static header_type header_htobe(header_type header) noexcept;
+
     /**
      * 设置读、写指针到 header，准备写入 header
      */
     void raw_rewind() noexcept;
 
+protected:
+    /**
+     * 共享 parent 的缓冲区, 参见 slice()
+     */
+    Package(const Package& parent, size_t offset, size_t len) noexcept;
+
 private:
     Package(const Package&) = delete;
     Package& operator=(const Package&) = delete;
 
+    /**
+     * 若缓冲区被共享, 则拷贝出独立的缓冲区
+     */
+    void detach() noexcept;
+
 private:
     uint8_t *_buffer = nullptr;
     size_t _capacity = 0;
@@ -1,6 +1,8 @@
 ﻿
 #include "../loofah_config.h"
 
+#include <algorithm> // for std::min(), std::max()
+
 #include <nut/rc/rc_new.h>
 #include <nut/logging/logger.h>
 
@@ -23,6 +25,7 @@ PackageChannelBase::~PackageChannelBase() noexcept
     assert(_poller->is_in_io_thread_and_not_polling());
 
     cancel_force_close_timer();
+    cancel_timeout_timers();
 }
 
 void PackageChannelBase::set_time_wheel(nut::TimeWheel *time_wheel) noexcept
@@ -39,6 +42,16 @@ nut::TimeWheel* PackageChannelBase::get_time_wheel() const noexcept
     return _time_wheel;
 }
 
+void PackageChannelBase::set_package_pool(PackagePool *pool) noexcept
+{
+    _package_pool = pool;
+}
+
+PackagePool* PackageChannelBase::get_package_pool() const noexcept
+{
+    return _package_pool;
+}
+
 void PackageChannelBase::set_max_payload_size(size_t max_size) noexcept
 {
     _max_payload_size = max_size;
@@ -49,6 +62,187 @@ size_t PackageChannelBase::get_max_payload_size() const noexcept
     return _max_payload_size;
 }
 
+void PackageChannelBase::set_read_timeout(uint64_t timeout_ms) noexcept
+{
+    _read_timeout_ms = timeout_ms;
+}
+
+uint64_t PackageChannelBase::get_read_timeout() const noexcept
+{
+    return _read_timeout_ms;
+}
+
+void PackageChannelBase::set_write_timeout(uint64_t timeout_ms) noexcept
+{
+    _write_timeout_ms = timeout_ms;
+}
+
+uint64_t PackageChannelBase::get_write_timeout() const noexcept
+{
+    return _write_timeout_ms;
+}
+
+void PackageChannelBase::set_lifetime_timeout(uint64_t timeout_ms) noexcept
+{
+    _lifetime_timeout_ms = timeout_ms;
+}
+
+uint64_t PackageChannelBase::get_lifetime_timeout() const noexcept
+{
+    return _lifetime_timeout_ms;
+}
+
+void PackageChannelBase::pause_reading() noexcept
+{
+    NUT_DEBUGGING_ASSERT_ALIVE;
+    assert(nullptr != _poller && _poller->is_in_io_thread());
+
+    if (_reading_paused)
+        return;
+    _reading_paused = true;
+
+    SockStream& sock_stream = get_sock_stream();
+    if (!sock_stream.is_null() && !sock_stream.is_reading_shutdown())
+        stop_reading();
+}
+
+void PackageChannelBase::resume_reading() noexcept
+{
+    NUT_DEBUGGING_ASSERT_ALIVE;
+    assert(nullptr != _poller && _poller->is_in_io_thread());
+
+    if (!_reading_paused)
+        return;
+    _reading_paused = false;
+
+    SockStream& sock_stream = get_sock_stream();
+    if (!sock_stream.is_null() && !sock_stream.is_reading_shutdown())
+        start_reading();
+}
+
+bool PackageChannelBase::is_reading_paused() const noexcept
+{
+    return _reading_paused;
+}
+
+void PackageChannelBase::set_read_budget(size_t max_bytes) noexcept
+{
+    _read_budget = max_bytes;
+}
+
+size_t PackageChannelBase::get_read_budget() const noexcept
+{
+    return _read_budget;
+}
+
+void PackageChannelBase::set_write_watermarks(size_t low_watermark, size_t high_watermark) noexcept
+{
+    assert(low_watermark <= high_watermark);
+    _write_low_watermark = low_watermark;
+    _write_high_watermark = high_watermark;
+}
+
+size_t PackageChannelBase::get_write_low_watermark() const noexcept
+{
+    return _write_low_watermark;
+}
+
+size_t PackageChannelBase::get_write_high_watermark() const noexcept
+{
+    return _write_high_watermark;
+}
+
+size_t PackageChannelBase::get_write_queue_bytes() const noexcept
+{
+    return _pkg_write_queue.bytes();
+}
+
+bool PackageChannelBase::is_write_backpressured() const noexcept
+{
+    return _write_backpressured;
+}
+
+void PackageChannelBase::handle_write_backpressure(bool paused) noexcept
+{
+    UNUSED(paused);
+}
+
+void PackageChannelBase::begin_batch() noexcept
+{
+    NUT_DEBUGGING_ASSERT_ALIVE;
+    assert(nullptr != _poller && _poller->is_in_io_thread());
+
+    ++_batch_depth;
+}
+
+void PackageChannelBase::flush() noexcept
+{
+    NUT_DEBUGGING_ASSERT_ALIVE;
+    assert(nullptr != _poller && _poller->is_in_io_thread());
+    assert(_batch_depth > 0);
+
+    if (--_batch_depth > 0 || !_batch_write_pending)
+        return;
+    _batch_write_pending = false;
+
+    // 批量写入期间可能已经关闭
+    SockStream& sock_stream = get_sock_stream();
+    if (sock_stream.is_null() || sock_stream.is_writing_shutdown() || _pkg_write_queue.empty())
+        return;
+    start_writing();
+}
+
+bool PackageChannelBase::is_batching() const noexcept
+{
+    return _batch_depth > 0;
+}
+
+void PackageChannelBase::push_write_queue(Package *pkg) noexcept
+{
+    assert(nullptr != pkg);
+
+    WriteEntry entry;
+    entry.pkg = pkg;
+    push_write_entry(std::move(entry));
+}
+
+void PackageChannelBase::push_write_queue(FileRegion *file) noexcept
+{
+    assert(nullptr != file);
+
+    WriteEntry entry;
+    entry.file = file;
+    push_write_entry(std::move(entry));
+}
+
+void PackageChannelBase::push_write_entry(WriteEntry&& entry) noexcept
+{
+    _pkg_write_queue.push_back(std::move(entry));
+    if (1 == _pkg_write_queue.size())
+        handle_write_queue_filled();
+
+    // NOTE 开始写之后再检查, 直接写出的部分不计入
+    if (!_write_backpressured && _pkg_write_queue.bytes() >= _write_high_watermark)
+    {
+        _write_backpressured = true;
+        handle_write_backpressure(true);
+    }
+}
+
+void PackageChannelBase::handle_write_queue_filled() noexcept
+{
+    assert(!_pkg_write_queue.empty());
+
+    // 写停滞从写队列变为非空时开始计时
+    if (0 != _write_timeout_ms)
+        _last_write_ms = TimerQueue::now_ms();
+
+    if (_batch_depth > 0)
+        _batch_write_pending = true;
+    else
+        start_writing();
+}
+
 void PackageChannelBase::close_later(int err, bool discard_write) noexcept
 {
     NUT_DEBUGGING_ASSERT_ALIVE;
@@ -87,7 +281,20 @@ void PackageChannelBase::setup_force_close_timer(int err) noexcept
     }
 
     // 超时强制关闭
-    if (nullptr == _time_wheel || NUT_INVALID_TIMER_ID != _force_close_timer)
+    if (nullptr == _time_wheel)
+    {
+        if (LOOFAH_INVALID_TIMER_ID != _force_close_poller_timer)
+            return;
+        _force_close_poller_timer = _poller->add_timer(
+            LOOFAH_FORCE_CLOSE_DELAY, 0,
+            [=] (PollerBase::timer_id_type) {
+                _force_close_poller_timer = LOOFAH_INVALID_TIMER_ID;
+                force_close(err);
+            });
+        return;
+    }
+
+    if (NUT_INVALID_TIMER_ID != _force_close_timer)
         return;
     _force_close_timer = _time_wheel->add_timer(
         LOOFAH_FORCE_CLOSE_DELAY, 0,
@@ -102,21 +309,113 @@ void PackageChannelBase::cancel_force_close_timer() noexcept
     NUT_DEBUGGING_ASSERT_ALIVE;
     assert(nullptr != _poller && _poller->is_in_io_thread());
 
+    if (LOOFAH_INVALID_TIMER_ID != _force_close_poller_timer)
+    {
+        _poller->cancel_timer(_force_close_poller_timer);
+        _force_close_poller_timer = LOOFAH_INVALID_TIMER_ID;
+    }
+
     if (nullptr == _time_wheel || NUT_INVALID_TIMER_ID == _force_close_timer)
         return;
     _time_wheel->cancel_timer(_force_close_timer);
     _force_close_timer = NUT_INVALID_TIMER_ID;
 }
 
+void PackageChannelBase::start_timeout_timers() noexcept
+{
+    NUT_DEBUGGING_ASSERT_ALIVE;
+    assert(nullptr != _poller && _poller->is_in_io_thread());
+
+    // NOTE 读写超时使用周期定时器, 到期时若期间有活动, 则将定时器推迟到按
+    //      最后活动时间计算的到期时刻
+    const uint64_t now = TimerQueue::now_ms();
+    if (0 != _read_timeout_ms && LOOFAH_INVALID_TIMER_ID == _read_timer)
+    {
+        _last_read_ms = now;
+        _read_timer = _poller->add_timer(
+            _read_timeout_ms, _read_timeout_ms,
+            [=] (PollerBase::timer_id_type id) {
+                // 暂停读取期间不计入读空闲
+                if (_reading_paused)
+                    _last_read_ms = TimerQueue::now_ms();
+                const uint64_t idle = TimerQueue::now_ms() - _last_read_ms;
+                if (idle < _read_timeout_ms)
+                {
+                    _poller->reset_timer(id, _read_timeout_ms - idle);
+                    return;
+                }
+                NUT_LOG_W(TAG, "read timeout, fd %d", get_sock_stream().get_socket());
+                handle_io_error(LOOFAH_ERR_TIMEOUT);
+            });
+    }
+
+    if (0 != _write_timeout_ms && LOOFAH_INVALID_TIMER_ID == _write_timer)
+    {
+        _last_write_ms = now;
+        _write_timer = _poller->add_timer(
+            _write_timeout_ms, _write_timeout_ms,
+            [=] (PollerBase::timer_id_type id) {
+                if (_pkg_write_queue.empty())
+                    return;
+                const uint64_t stall = TimerQueue::now_ms() - _last_write_ms;
+                if (stall < _write_timeout_ms)
+                {
+                    _poller->reset_timer(id, _write_timeout_ms - stall);
+                    return;
+                }
+                NUT_LOG_W(TAG, "write timeout, fd %d", get_sock_stream().get_socket());
+                handle_io_error(LOOFAH_ERR_TIMEOUT);
+            });
+    }
+
+    if (0 != _lifetime_timeout_ms && LOOFAH_INVALID_TIMER_ID == _lifetime_timer)
+    {
+        _lifetime_timer = _poller->add_timer(
+            _lifetime_timeout_ms, 0,
+            [=] (PollerBase::timer_id_type) {
+                _lifetime_timer = LOOFAH_INVALID_TIMER_ID;
+                NUT_LOG_W(TAG, "lifetime timeout, fd %d", get_sock_stream().get_socket());
+                handle_io_error(LOOFAH_ERR_TIMEOUT);
+            });
+    }
+}
+
+void PackageChannelBase::cancel_timeout_timers() noexcept
+{
+    NUT_DEBUGGING_ASSERT_ALIVE;
+    assert(nullptr != _poller && _poller->is_in_io_thread());
+
+    if (LOOFAH_INVALID_TIMER_ID != _read_timer)
+    {
+        _poller->cancel_timer(_read_timer);
+        _read_timer = LOOFAH_INVALID_TIMER_ID;
+    }
+    if (LOOFAH_INVALID_TIMER_ID != _write_timer)
+    {
+        _poller->cancel_timer(_write_timer);
+        _write_timer = LOOFAH_INVALID_TIMER_ID;
+    }
+    if (LOOFAH_INVALID_TIMER_ID != _lifetime_timer)
+    {
+        _poller->cancel_timer(_lifetime_timer);
+        _lifetime_timer = LOOFAH_INVALID_TIMER_ID;
+    }
+}
+
 void PackageChannelBase::split_and_handle_packages(size_t extra_readed) noexcept
 {
     NUT_DEBUGGING_ASSERT_ALIVE;
     assert(nullptr != _poller && _poller->is_in_io_thread());
 
+    // 记录读活动时间
+    if (0 != _read_timeout_ms)
+        _last_read_ms = TimerQueue::now_ms();
+
     // 分包
     nut::rc_ptr<Package> buffer_pkg = _reading_pkg;
+    buffer_pkg->skip_write(extra_readed);
     std::vector<nut::rc_ptr<Package>> full_packages;
-    const size_t total_size = buffer_pkg->readable_size() + extra_readed;
+    const size_t total_size = buffer_pkg->readable_size();
     size_t processed_size = 0;
     bool payload_oversize = false;
     while (processed_size < total_size)
@@ -125,16 +424,12 @@ void PackageChannelBase::split_and_handle_packages(size_t extra_readed) noexcept
         const uint8_t *readable_data = ((const uint8_t*) buffer_pkg->readable_data()) + processed_size;
 
         // header 尚未读完
+        // NOTE 读缓冲远大于预分配大小时也换成新的小缓冲, 避免空闲连接占用内存
         if (remained_size < sizeof(Package::header_type))
         {
-            if (0 == processed_size)
-            {
-                buffer_pkg->skip_write(extra_readed);
-            }
-            else
+            if (0 != processed_size || buffer_pkg->capacity() > 2 * _read_pkg_size)
             {
-                nut::rc_ptr<Package> new_pkg = nut::rc_new<Package>(LOOFAH_INIT_READ_PKG_SIZE);
-                new_pkg->raw_rewind();
+                nut::rc_ptr<Package> new_pkg = new_reading_package();
                 ::memcpy(new_pkg->writable_data(), readable_data, remained_size);
                 new_pkg->skip_write(remained_size);
 
@@ -158,8 +453,6 @@ void PackageChannelBase::split_and_handle_packages(size_t extra_readed) noexcept
         {
             if (0 == processed_size)
             {
-                buffer_pkg->skip_write(extra_readed);
-
                 // NOTE The last extra header_type space is for reading next package size
                 assert(pkg_size - total_size > 0);
                 buffer_pkg->ensure_writable_size(pkg_size - total_size + sizeof(Package::header_type));
@@ -167,7 +460,7 @@ void PackageChannelBase::split_and_handle_packages(size_t extra_readed) noexcept
             else
             {
                 // NOTE The last extra header_type space is for reading next package size
-                nut::rc_ptr<Package> new_pkg = nut::rc_new<Package>(payload_size + sizeof(Package::header_type));
+                nut::rc_ptr<Package> new_pkg = new_package(payload_size + sizeof(Package::header_type));
                 new_pkg->raw_rewind();
                 ::memcpy(new_pkg->writable_data(), readable_data, remained_size);
                 new_pkg->skip_write(remained_size);
@@ -178,19 +471,16 @@ void PackageChannelBase::split_and_handle_packages(size_t extra_readed) noexcept
         }
 
         // 完整 package
-        if (0 == processed_size)
+        if (processed_size + pkg_size == total_size)
         {
-            buffer_pkg->skip_write(pkg_size - buffer_pkg->readable_size());
+            // 最后一个 package 直接使用读缓冲
+            buffer_pkg->skip_read(processed_size);
             full_packages.push_back(buffer_pkg);
         }
         else
         {
-            nut::rc_ptr<Package> new_pkg = nut::rc_new<Package>(payload_size);
-            new_pkg->raw_rewind();
-            ::memcpy(new_pkg->writable_data(), readable_data, pkg_size);
-            new_pkg->skip_write(pkg_size);
-
-            full_packages.push_back(std::move(new_pkg));
+            // NOTE 与读缓冲共享内存, 不拷贝
+            full_packages.push_back(buffer_pkg->slice(processed_size, pkg_size));
         }
         _reading_pkg = nullptr;
         processed_size += pkg_size;
@@ -213,6 +503,163 @@ void PackageChannelBase::split_and_handle_packages(size_t extra_readed) noexcept
         handle_io_error(LOOFAH_ERR_PKG_OVERSIZE);
 }
 
+nut::rc_ptr<Package> PackageChannelBase::new_package(size_t payload_size) noexcept
+{
+    if (nullptr != _package_pool)
+        return _package_pool->acquire(payload_size);
+    return nut::rc_new<Package>(payload_size);
+}
+
+nut::rc_ptr<Package> PackageChannelBase::new_reading_package() noexcept
+{
+    nut::rc_ptr<Package> pkg = new_package(_read_pkg_size);
+    pkg->raw_rewind();
+    return pkg;
+}
+
+void PackageChannelBase::adapt_read_pkg_size(size_t readed) noexcept
+{
+    if (readed >= _read_pkg_size)
+    {
+        _read_pkg_size = std::min<size_t>(_read_pkg_size * 2, LOOFAH_MAX_READ_PKG_SIZE);
+        _read_pkg_shrink_count = 0;
+    }
+    else if (readed < _read_pkg_size / 2 && _read_pkg_size > LOOFAH_MIN_READ_PKG_SIZE)
+    {
+        if (++_read_pkg_shrink_count < LOOFAH_READ_PKG_SHRINK_THRESHOLD)
+            return;
+        _read_pkg_size = std::max<size_t>(_read_pkg_size / 2, LOOFAH_MIN_READ_PKG_SIZE);
+        _read_pkg_shrink_count = 0;
+    }
+    else
+    {
+        _read_pkg_shrink_count = 0;
+    }
+}
+
+size_t PackageChannelBase::prepare_write_bufs(void ***buf_ptrs, size_t **len_ptrs) noexcept
+{
+    assert(nullptr != buf_ptrs && nullptr != len_ptrs);
+    assert(!_pkg_write_queue.empty() && !is_write_queue_front_file());
+
+    _write_bufs.clear();
+    _write_lens.clear();
+    size_t total_bytes = 0;
+    for (size_t i = 0, count = _pkg_write_queue.size();
+         i < count && _write_bufs.size() < LOOFAH_MAX_WRITE_BUFS; ++i)
+    {
+        // 文件片段需要单独发送
+        Package *pkg = _pkg_write_queue[i].pkg;
+        if (nullptr == pkg)
+            break;
+        const size_t len = pkg->readable_size();
+        if (!_write_bufs.empty() && total_bytes + len > LOOFAH_MAX_WRITE_BYTES)
+            break;
+
+        _write_bufs.push_back((void*) pkg->readable_data()); // NOTE (const void*) 转成 (void*) 只是为了方便传入参数
+        _write_lens.push_back(len);
+        total_bytes += len;
+    }
+
+    *buf_ptrs = _write_bufs.data();
+    *len_ptrs = _write_lens.data();
+    return _write_bufs.size();
+}
+
+void PackageChannelBase::pop_written_packages(size_t written) noexcept
+{
+    // 记录写活动时间
+    if (0 != _write_timeout_ms && written > 0)
+        _last_write_ms = TimerQueue::now_ms();
+
+    while (written > 0)
+    {
+        assert(!_pkg_write_queue.empty());
+        const size_t readable = _pkg_write_queue.front().size();
+        if (written >= readable)
+        {
+            _pkg_write_queue.pop_front();
+            written -= readable;
+        }
+        else
+        {
+            _pkg_write_queue.skip_front(written);
+            written = 0;
+        }
+    }
+
+    if (_write_backpressured && _pkg_write_queue.bytes() <= _write_low_watermark)
+    {
+        _write_backpressured = false;
+        handle_write_backpressure(false);
+    }
+}
+
+bool PackageChannelBase::is_write_queue_front_file() const noexcept
+{
+    return !_pkg_write_queue.empty() && nullptr != _pkg_write_queue.front().file;
+}
+
+ssize_t PackageChannelBase::send_write_queue_front_file() noexcept
+{
+    assert(is_write_queue_front_file());
+
+    FileRegion *file = _pkg_write_queue.front().file;
+    return file->send_to(get_sock_stream().get_socket(), LOOFAH_MAX_WRITE_BYTES);
+}
+
+int PackageChannelBase::load_write_queue_front_file() noexcept
+{
+    assert(is_write_queue_front_file());
+
+    FileRegion *file = _pkg_write_queue.front().file;
+    const size_t len = std::min<size_t>(file->remaining_size(), LOOFAH_MAX_WRITE_BYTES);
+    nut::rc_ptr<Package> pkg = new_package(len);
+    pkg->raw_rewind();
+    assert(pkg->writable_size() >= len);
+    const ssize_t rs = file->read(pkg->writable_data(), len);
+    if (rs < 0)
+        return (int) rs;
+    pkg->skip_write(rs);
+
+    // NOTE 文件片段中读出的部分转移到 package 中, 队列总字节数不变
+    _pkg_write_queue.skip_front(rs);
+    if (0 == file->remaining_size())
+        _pkg_write_queue.pop_front();
+    WriteEntry entry;
+    entry.pkg = std::move(pkg);
+    _pkg_write_queue.push_front(std::move(entry));
+    return 0;
+}
+
+void PackageChannelBase::send_file(int fd, int64_t offset, size_t len, bool close_fd) noexcept
+{
+    NUT_DEBUGGING_ASSERT_ALIVE;
+    assert(nullptr != _poller && _poller->is_in_io_thread());
+    assert(len <= 0xffffffffu);
+
+    nut::rc_ptr<FileRegion> file = nut::rc_new<FileRegion>(fd, offset, len, close_fd);
+    if (_closing.load(std::memory_order_relaxed))
+    {
+        NUT_LOG_W(TAG, "channel is closing or closed, sending file discard. fd %d",
+                  get_sock_stream().get_socket());
+        return;
+    }
+
+    // header
+    nut::rc_ptr<Package> header = new_package(sizeof(Package::header_type));
+    header->raw_rewind();
+    const Package::header_type be_len = Package::header_htobe((Package::header_type) len);
+    header->write(&be_len, sizeof(be_len));
+
+    // NOTE 批量写入, 保证 header 和文件内容一起开始写
+    begin_batch();
+    push_write_queue(header);
+    if (len > 0)
+        push_write_queue(file);
+    flush();
+}
+
 void PackageChannelBase::write_later(Package *pkg) noexcept
 {
     assert(nullptr != pkg);
@@ -4,7 +4,7 @@
 
 #include "../loofah_config.h"
 
-#include <deque>
+#include <vector>
 #include <atomic>
 
 #include <nut/rc/rc_ptr.h>
@@ -14,6 +14,9 @@
 #include "../inet_base/poller_base.h"
 #include "../inet_base/sock_stream.h"
 #include "package.h"
+#include "package_pool.h"
+#include "file_region.h"
+#include "write_queue.h"
 
 
 namespace loofah
@@ -29,12 +32,91 @@ class LOOFAH_API PackageChannelBase
 public:
     virtual ~PackageChannelBase() noexcept;
 
+    /**
+     * 设置用于强制关闭超时的时间轮; 未设置时使用 poller 内置的定时器
+     */
     void set_time_wheel(nut::TimeWheel *time_wheel) noexcept;
     nut::TimeWheel* get_time_wheel() const noexcept;
 
+    /**
+     * 设置 package 池, 读到的 package 将从池中分配
+     */
+    void set_package_pool(PackagePool *pool) noexcept;
+    PackagePool* get_package_pool() const noexcept;
+
     void set_max_payload_size(size_t max_size) noexcept;
     size_t get_max_payload_size() const noexcept;
 
+    /**
+     * 设置读空闲超时, 超过指定时间没有读到数据, 则以 LOOFAH_ERR_TIMEOUT 关闭连接
+     *
+     * NOTE 超时相关设置需要在连接建立前进行, 0 表示不超时
+     */
+    void set_read_timeout(uint64_t timeout_ms) noexcept;
+    uint64_t get_read_timeout() const noexcept;
+
+    /**
+     * 设置写停滞超时, 写队列非空且超过指定时间没有写出数据, 则以
+     * LOOFAH_ERR_TIMEOUT 关闭连接
+     */
+    void set_write_timeout(uint64_t timeout_ms) noexcept;
+    uint64_t get_write_timeout() const noexcept;
+
+    /**
+     * 设置连接的最长存活时间, 从连接建立开始计时, 到期则以 LOOFAH_ERR_TIMEOUT
+     * 关闭连接
+     */
+    void set_lifetime_timeout(uint64_t timeout_ms) noexcept;
+    uint64_t get_lifetime_timeout() const noexcept;
+
+    /**
+     * 暂停读取, 数据积压在内核接收缓冲中, 由 TCP 流量控制向对端传递背压
+     *
+     * NOTE
+     * - 只能在 IO 线程中调用
+     * - 暂停前已经读到的 package 仍会继续分发
+     * - 暂停期间不能及时察觉对端关闭连接
+     */
+    void pause_reading() noexcept;
+
+    /**
+     * 恢复读取
+     */
+    void resume_reading() noexcept;
+
+    bool is_reading_paused() const noexcept;
+
+    /**
+     * 设置单轮 poll() 最多读取的字节数, 超出后让给其他连接, 剩余数据留到下一轮
+     *
+     * NOTE 0 表示使用 Reactor::get_read_quota(); 只对 ReactPackageChannel 有效,
+     *      ProactPackageChannel 每次读完成只读一次
+     */
+    void set_read_budget(size_t max_bytes) noexcept;
+    size_t get_read_budget() const noexcept;
+
+    /**
+     * 设置写队列高低水位(字节数)
+     *
+     * 写队列中待写出的字节数达到高水位时, 触发 handle_write_backpressure(true),
+     * 此后降到低水位及以下时, 触发 handle_write_backpressure(false)
+     *
+     * NOTE 只是通知, write() 并不会因此丢弃数据
+     */
+    void set_write_watermarks(size_t low_watermark, size_t high_watermark) noexcept;
+    size_t get_write_low_watermark() const noexcept;
+    size_t get_write_high_watermark() const noexcept;
+
+    /**
+     * 写队列中待写出的字节数
+     */
+    size_t get_write_queue_bytes() const noexcept;
+
+    /**
+     * 写队列是否处于高水位状态
+     */
+    bool is_write_backpressured() const noexcept;
+
     virtual SockStream& get_sock_stream() noexcept = 0;
 
     /**
@@ -56,6 +138,15 @@ public:
      */
     virtual void handle_closed(int err) noexcept = 0;
 
+    /**
+     * 写队列越过高水位或者回落到低水位
+     *
+     * 可以在这里暂停、恢复生产数据, 或者暂停读取对端数据以传递背压
+     *
+     * @param paused 越过高水位时为 true, 回落到低水位时为 false
+     */
+    virtual void handle_write_backpressure(bool paused) noexcept;
+
     /**
      * 写数据
      *
@@ -64,6 +155,38 @@ public:
     virtual void write(Package *pkg) noexcept = 0;
     void write_later(Package *pkg) noexcept;
 
+    /**
+     * 以一个 package 的形式发送文件内容, 对端读到的 package 的 payload 即为
+     * 文件内容; 与 write() 写入的 package 在同一个写队列中依次发送
+     *
+     * ReactPackageChannel 在 Linux、macOS 下使用 sendfile(), 文件内容不经过
+     * 用户态; ProactPackageChannel 则分段读入 package 后再写出
+     *
+     * NOTE
+     * - 只能在 IO 线程中调用; 调用 close() 后再调用将被忽略
+     * - 发送完成前文件内容不能改变
+     *
+     * @param close_fd 发送完成或者被丢弃后是否关闭 fd
+     */
+    void send_file(int fd, int64_t offset, size_t len, bool close_fd = false) noexcept;
+
+    /**
+     * 开始批量写入, 之后 write() 的 package 只放入写队列, 直到 flush() 时再用
+     * 一次 writev() 合并写出, 以减少系统调用和小 TCP 分段
+     *
+     * NOTE
+     * - 可以嵌套调用, 最外层的 flush() 才真正开始写
+     * - 只能在 IO 线程中调用
+     */
+    void begin_batch() noexcept;
+
+    /**
+     * 结束批量写入, 并开始写出写队列中的数据
+     */
+    void flush() noexcept;
+
+    bool is_batching() const noexcept;
+
     /**
      * 关闭连接
      *
@@ -82,6 +205,78 @@ protected:
      */
     void split_and_handle_packages(size_t extra_readed) noexcept;
 
+    /**
+     * 分配一个空 package, 如果设置了 package 池则从池中分配
+     */
+    nut::rc_ptr<Package> new_package(size_t payload_size) noexcept;
+
+    /**
+     * 分配一个读缓冲, 大小根据最近的读取情况自适应调整
+     */
+    nut::rc_ptr<Package> new_reading_package() noexcept;
+
+    /**
+     * 根据单次读取的字节数调整读缓冲的预分配大小: 读满则倍增; 连续多次不足
+     * 一半则减半
+     */
+    void adapt_read_pkg_size(size_t readed) noexcept;
+
+    /**
+     * 将写队列头部的数据填入可复用的 scatter/gather 缓冲中, 个数不超过
+     * LOOFAH_MAX_WRITE_BUFS, 字节数不超过 LOOFAH_MAX_WRITE_BYTES
+     *
+     * NOTE 返回的缓冲在下次调用前有效
+     *
+     * @return 缓冲个数
+     */
+    size_t prepare_write_bufs(void ***buf_ptrs, size_t **len_ptrs) noexcept;
+
+    /**
+     * 从写队列中移除已写出的 written 字节
+     */
+    void pop_written_packages(size_t written) noexcept;
+
+    /**
+     * 开始写出写队列中的数据
+     */
+    virtual void start_writing() noexcept = 0;
+
+    /**
+     * 停止、开始从 socket 读取数据, 由 pause_reading() / resume_reading() 调用
+     */
+    virtual void stop_reading() noexcept = 0;
+    virtual void start_reading() noexcept = 0;
+
+    /**
+     * 将已打包的 package 或者文件片段放入写队列, 并在写队列由空变为非空时开始写
+     */
+    void push_write_queue(Package *pkg) noexcept;
+    void push_write_queue(FileRegion *file) noexcept;
+
+    /**
+     * 写队列头部是否为文件片段
+     *
+     * NOTE prepare_write_bufs() 只收集文件片段之前的 package
+     */
+    bool is_write_queue_front_file() const noexcept;
+
+    /**
+     * 将写队列头部的文件片段直接发送到 socket, 参见 FileRegion::send_to()
+     */
+    ssize_t send_write_queue_front_file() noexcept;
+
+    /**
+     * 从写队列头部的文件片段中读出一段, 作为 package 插入到写队列头部
+     *
+     * @return 0 成功; <0 错误码
+     */
+    int load_write_queue_front_file() noexcept;
+
+    /**
+     * 写队列由空变为非空时调用, 批量写入期间推迟到 flush() 时再开始写
+     */
+    void handle_write_queue_filled() noexcept;
+
     // 关闭连接
     virtual void force_close(int err) noexcept = 0;
 
@@ -89,13 +284,16 @@ protected:
     void setup_force_close_timer(int err) noexcept;
     void cancel_force_close_timer() noexcept;
 
+    // 连接建立后开始超时计时
+    void start_timeout_timers() noexcept;
+    void cancel_timeout_timers() noexcept;
+
 protected:
     // 轮询器
     PollerBase *_poller = nullptr;
 
-    // 写队列
-    typedef std::deque<nut::rc_ptr<Package>> queue_t;
-    queue_t _pkg_write_queue;
+    // 写队列, 元素为 package 或者文件片段
+    WriteQueue _pkg_write_queue;
 
     // 读缓存
     nut::rc_ptr<Package> _reading_pkg;
@@ -103,15 +301,51 @@ protected:
     // 是否等待关闭
     std::atomic<bool> _closing = ATOMIC_VAR_INIT(false);
 
+    // 是否暂停读取, 以及单轮最多读取的字节数
+    bool _reading_paused = false;
+    size_t _read_budget = 0;
+
     NUT_DEBUGGING_DESTROY_CHECKER
 
 private:
+    void push_write_entry(WriteEntry&& entry) noexcept;
+
+private:
+    // scatter/gather 写缓冲
+    std::vector<void*> _write_bufs;
+    std::vector<size_t> _write_lens;
+
+    // 写队列高低水位
+    size_t _write_low_watermark = LOOFAH_DEFAULT_WRITE_LOW_WATERMARK;
+    size_t _write_high_watermark = LOOFAH_DEFAULT_WRITE_HIGH_WATERMARK;
+    bool _write_backpressured = false;
+
+    // 批量写入嵌套深度, 以及期间是否有被推迟的写
+    unsigned _batch_depth = 0;
+    bool _batch_write_pending = false;
+
+    // 读缓冲的预分配大小, 以及连续读取字节数不足一半的次数
+    size_t _read_pkg_size = LOOFAH_INIT_READ_PKG_SIZE;
+    unsigned _read_pkg_shrink_count = 0;
+
     // 最大 package payload 大小
     size_t _max_payload_size = LOOFAH_DEFAULT_MAX_PKG_SIZE;
 
+    // package 池
+    nut::rc_ptr<PackagePool> _package_pool;
+
     // 延时强制关闭
     nut::TimeWheel *_time_wheel = nullptr;
     nut::TimeWheel::timer_id_type _force_close_timer = NUT_INVALID_TIMER_ID;
+    PollerBase::timer_id_type _force_close_poller_timer = LOOFAH_INVALID_TIMER_ID;
+
+    // 读空闲、写停滞、存活超时
+    // NOTE 读写时只记录活动时间, 定时器到期时再检查, 避免每次读写都调整定时器
+    uint64_t _read_timeout_ms = 0, _write_timeout_ms = 0, _lifetime_timeout_ms = 0;
+    uint64_t _last_read_ms = 0, _last_write_ms = 0;
+    PollerBase::timer_id_type _read_timer = LOOFAH_INVALID_TIMER_ID;
+    PollerBase::timer_id_type _write_timer = LOOFAH_INVALID_TIMER_ID;
+    PollerBase::timer_id_type _lifetime_timer = LOOFAH_INVALID_TIMER_ID;
 };
 
 }
@@ -0,0 +1,175 @@
+﻿
+#include "../loofah_config.h"
+
+#include <assert.h>
+
+#include <nut/rc/rc_new.h>
+
+#include "package_pool.h"
+
+
+namespace loofah
+{
+
+namespace
+{
+
+size_t level_size(size_t level) noexcept
+{
+    return PackagePool::MIN_LEVEL_SIZE << (2 * level);
+}
+
+/**
+ * 能容纳 payload_size 的最小级别; 超过最大级别返回 LEVEL_COUNT
+ */
+size_t ceil_level(size_t payload_size) noexcept
+{
+    size_t level = 0;
+    while (level < PackagePool::LEVEL_COUNT && level_size(level) < payload_size)
+        ++level;
+    return level;
+}
+
+/**
+ * 容量 capacity 所能满足的最大级别; 容量过小或者过大都返回 LEVEL_COUNT
+ */
+size_t floor_level(size_t capacity) noexcept
+{
+    if (capacity < PackagePool::MIN_LEVEL_SIZE ||
+        capacity >= level_size(PackagePool::LEVEL_COUNT))
+        return PackagePool::LEVEL_COUNT;
+
+    size_t level = 0;
+    while (level + 1 < PackagePool::LEVEL_COUNT && level_size(level + 1) <= capacity)
+        ++level;
+    return level;
+}
+
+}
+
+/**
+ * 由 PackagePool 分配的 Package, 最后一个引用释放时回收到池中
+ */
+class PooledPackage final : public Package
+{
+    friend class PackagePool;
+
+public:
+    explicit PooledPackage(size_t init_cap) noexcept
+        : Package(init_cap)
+    {}
+
+    virtual int add_ref() const noexcept override
+    {
+        return _ref_count.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    virtual int release_ref() const noexcept override
+    {
+        const int ret = _ref_count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        if (0 == ret)
+        {
+            PooledPackage *self = const_cast<PooledPackage*>(this);
+            // NOTE 回收后不能再访问 'this', 池本身也可能随之析构
+            nut::rc_ptr<PackagePool> pool = std::move(self->_pool);
+            pool->recycle(self);
+        }
+        return ret;
+    }
+
+    virtual int get_ref() const noexcept override
+    {
+        return _ref_count.load(std::memory_order_relaxed);
+    }
+
+private:
+    mutable std::atomic<int> _ref_count = ATOMIC_VAR_INIT(0);
+
+    // 使用中持有池的引用, 空闲时置空, 避免循环引用
+    nut::rc_ptr<PackagePool> _pool;
+};
+
+PackagePool::~PackagePool() noexcept
+{
+    for (size_t i = 0; i < LEVEL_COUNT; ++i)
+    {
+        for (PooledPackage *pkg : _free_lists[i])
+            delete pkg;
+        _free_lists[i].clear();
+    }
+}
+
+nut::rc_ptr<Package> PackagePool::acquire(size_t payload_size) noexcept
+{
+    const size_t level = ceil_level(payload_size);
+    if (level >= LEVEL_COUNT)
+    {
+        _miss_count.fetch_add(1, std::memory_order_relaxed);
+        return nut::rc_new<Package>(payload_size);
+    }
+
+    PooledPackage *pkg = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        std::vector<PooledPackage*>& free_list = _free_lists[level];
+        if (!free_list.empty())
+        {
+            pkg = free_list.back();
+            free_list.pop_back();
+        }
+    }
+
+    if (nullptr != pkg)
+    {
+        _hit_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        _miss_count.fetch_add(1, std::memory_order_relaxed);
+        pkg = new PooledPackage(level_size(level));
+    }
+    assert(pkg->capacity() >= payload_size);
+    pkg->_pool = this;
+    return pkg;
+}
+
+void PackagePool::recycle(PooledPackage *pkg) noexcept
+{
+    assert(nullptr != pkg && 0 == pkg->get_ref());
+
+    // NOTE 缓冲区可能被扩容过, 也可能因仍被 slice 共享而被释放, 按照当前容量重新定级
+    pkg->reset();
+    const size_t level = floor_level(pkg->capacity());
+    if (level < LEVEL_COUNT)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        std::vector<PooledPackage*>& free_list = _free_lists[level];
+        if (free_list.size() < LOOFAH_PACKAGE_POOL_MAX_CACHED)
+        {
+            free_list.push_back(pkg);
+            return;
+        }
+    }
+    delete pkg;
+}
+
+size_t PackagePool::get_hit_count() const noexcept
+{
+    return _hit_count.load(std::memory_order_relaxed);
+}
+
+size_t PackagePool::get_miss_count() const noexcept
+{
+    return _miss_count.load(std::memory_order_relaxed);
+}
+
+size_t PackagePool::get_cached_count() const noexcept
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    size_t ret = 0;
+    for (size_t i = 0; i < LEVEL_COUNT; ++i)
+        ret += _free_lists[i].size();
+    return ret;
+}
+
+}
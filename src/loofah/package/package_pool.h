@@ -0,0 +1,84 @@
+﻿
+#ifndef ___HEADFILE_D6EDD8F8_F039_4E42_9FFE_63CDF8A39EAE_
+#define ___HEADFILE_D6EDD8F8_F039_4E42_9FFE_63CDF8A39EAE_
+
+#include "../loofah_config.h"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include <nut/rc/rc_ptr.h>
+
+#include "package.h"
+
+
+namespace loofah
+{
+
+class PooledPackage;
+
+/**
+ * Package 池, 按 payload 容量分级缓存空闲的 Package 及其缓冲区
+ *
+ * 最后一个 rc_ptr 释放时, Package 对象连同缓冲区一起回收到池中, 下次分配相近
+ * 大小时直接复用, 避免 malloc
+ *
+ * NOTE
+ * - 一般每个 poller 一个池, 通过 PackageChannelBase::set_package_pool() 设置
+ * - acquire() 应在 IO 线程中调用; 回收可以发生在任意线程
+ */
+class LOOFAH_API PackagePool
+{
+    NUT_REF_COUNTABLE
+
+    friend class PooledPackage;
+
+public:
+    // 大小级别: 256, 1K, 4K, 16K, 64K
+    static constexpr size_t MIN_LEVEL_SIZE = 256;
+    static constexpr size_t LEVEL_COUNT = 5;
+
+public:
+    PackagePool() = default;
+    virtual ~PackagePool() noexcept;
+
+    /**
+     * 分配一个 payload 容量不小于 payload_size 的空 Package
+     *
+     * NOTE 超过最大级别的 Package 不经过池, 直接分配
+     */
+    nut::rc_ptr<Package> acquire(size_t payload_size) noexcept;
+
+    /**
+     * 命中缓存的分配次数
+     */
+    size_t get_hit_count() const noexcept;
+
+    /**
+     * 未命中缓存而新分配的次数
+     */
+    size_t get_miss_count() const noexcept;
+
+    /**
+     * 当前缓存的空闲 Package 数
+     */
+    size_t get_cached_count() const noexcept;
+
+private:
+    PackagePool(const PackagePool&) = delete;
+    PackagePool& operator=(const PackagePool&) = delete;
+
+    void recycle(PooledPackage *pkg) noexcept;
+
+private:
+    mutable std::mutex _lock;
+    std::vector<PooledPackage*> _free_lists[LEVEL_COUNT];
+
+    std::atomic<size_t> _hit_count = ATOMIC_VAR_INIT(0);
+    std::atomic<size_t> _miss_count = ATOMIC_VAR_INIT(0);
+};
+
+}
+
+#endif
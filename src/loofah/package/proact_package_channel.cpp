@@ -44,8 +44,10 @@ void ProactPackageChannel::handle_channel_connected() noexcept
     assert(nullptr != _poller && _poller->is_in_io_thread());
 
     ((Proactor*) _poller)->register_handler(this);
-    launch_read();
+    if (!_reading_paused)
+        launch_read();
 
+    start_timeout_timers();
     handle_connected();
 }
 
@@ -87,6 +89,7 @@ void ProactPackageChannel::force_close(int err) noexcept
     if (_sock_stream.is_null())
         return;
     cancel_force_close_timer();
+    cancel_timeout_timers();
     ((Proactor*) _poller)->unregister_handler(this);
     _sock_stream.close();
 
@@ -113,13 +116,11 @@ void ProactPackageChannel::launch_read() noexcept
     assert(!_sock_stream.is_null() && !_sock_stream.is_reading_shutdown());
 
     if (nullptr == _reading_pkg)
-    {
-        _reading_pkg = nut::rc_new<Package>(LOOFAH_INIT_READ_PKG_SIZE);
-        _reading_pkg->raw_rewind();
-    }
+        _reading_pkg = new_reading_package();
 
     void *const buf = _reading_pkg->writable_data();
     const size_t buf_cap = _reading_pkg->writable_size();
+    _reading = true;
     ((Proactor*) _poller)->launch_read(this, &buf, &buf_cap, 1);
 }
 
@@ -129,6 +130,7 @@ void ProactPackageChannel::handle_read_completed(size_t cb) noexcept
     assert(nullptr != _poller && _poller->is_in_io_thread());
     assert(nullptr != _reading_pkg);
 
+    _reading = false;
     if (0 == cb)
     {
         // Read channel closed
@@ -140,9 +142,23 @@ void ProactPackageChannel::handle_read_completed(size_t cb) noexcept
         return;
     }
 
+    adapt_read_pkg_size(cb);
     split_and_handle_packages(cb);
 
-    launch_read();
+    // NOTE 可能在 handle_read() 中暂停了读取, 或者关闭了连接
+    if (!_reading_paused && !_reading && !_sock_stream.is_null() && !_sock_stream.is_reading_shutdown())
+        launch_read();
+}
+
+void ProactPackageChannel::stop_reading() noexcept
+{
+    // NOTE 已经发出的读请求无法撤回, 完成后不再发出新的读请求
+}
+
+void ProactPackageChannel::start_reading() noexcept
+{
+    if (nullptr != _registered_proactor && !_reading)
+        launch_read();
 }
 
 void ProactPackageChannel::write(Package *pkg) noexcept
@@ -159,8 +175,13 @@ void ProactPackageChannel::write(Package *pkg) noexcept
     }
 
     pkg->raw_pack();
-    _pkg_write_queue.push_back(pkg);
-    if (1 == _pkg_write_queue.size())
+    push_write_queue(pkg);
+}
+
+void ProactPackageChannel::start_writing() noexcept
+{
+    // NOTE 可能在 handle_write_completed() 的回调中被调用, 此时写请求已经发出
+    if (!_writing)
         launch_write();
 }
 
@@ -182,21 +203,26 @@ void ProactPackageChannel::launch_write() noexcept
     }
 #endif
 
+    // 文件片段读入 package 后再写出
+    // NOTE 异步写只能提交缓冲区, 不能使用 sendfile()
     assert(!_pkg_write_queue.empty());
-    const size_t buf_count = _pkg_write_queue.size();
-    void **bufs = (void**) ::alloca(sizeof(void*) * buf_count + sizeof(size_t) * buf_count);
-    size_t *lens = (size_t*) (bufs + buf_count);
-
-    queue_t::const_iterator iter = _pkg_write_queue.begin();
-    for (size_t i = 0; i < buf_count; ++i, ++iter)
+    if (is_write_queue_front_file())
     {
-        Package *pkg = *iter;
-        assert(nullptr != pkg);
-        bufs[i] = (void*) pkg->readable_data(); // NOTE (const void*) 转成 (void*) 只是为了方便传入参数
-        lens[i] = pkg->readable_size();
+        const int rs = load_write_queue_front_file();
+        if (rs < 0)
+        {
+            handle_io_error(rs);
+            return;
+        }
     }
 
+    // NOTE 写队列过长时分多次写出, 完成后在 handle_write_completed() 中继续
+    void **bufs = nullptr;
+    size_t *lens = nullptr;
+    const size_t buf_count = prepare_write_bufs(&bufs, &lens);
+
     assert(nullptr != _poller);
+    _writing = true;
     ((Proactor*) _poller)->launch_write(this, bufs, lens, buf_count);
 }
 
@@ -208,25 +234,13 @@ void ProactPackageChannel::handle_write_completed(size_t cb) noexcept
     // NOTE '_closing' 可能为 true, 做关闭前最后的写入
 
     // 从本地写队列中移除已写内容
-    while (cb > 0)
-    {
-        assert(!_pkg_write_queue.empty());
-        Package *pkg = _pkg_write_queue.front();
-        assert(nullptr != pkg);
-        const size_t readable = pkg->readable_size();
-        if (cb >= readable)
-        {
-            _pkg_write_queue.pop_front();
-            cb -= readable;
-        }
-        else
-        {
-            pkg->skip_read(cb);
-            cb = 0;
-        }
-    }
+    // NOTE 可能触发 handle_write_backpressure(), 并在其中写入新的数据
+    _writing = false;
+    pop_written_packages(cb);
 
     // 如果本地写队列中还有内容，继续写
+    if (_writing)
+        return;
     if (!_pkg_write_queue.empty())
     {
         launch_write();
@@ -56,6 +56,16 @@ private:
     // 向 proactor 请求 write 操作
     void launch_write() noexcept;
 
+    virtual void start_writing() noexcept final override;
+
+private:
+    virtual void stop_reading() noexcept final override;
+    virtual void start_reading() noexcept final override;
+
+private:
+    // 是否有尚未完成的读、写请求
+    bool _reading = false, _writing = false;
+
     // 关闭连接
     virtual void force_close(int err) noexcept final override;
 };
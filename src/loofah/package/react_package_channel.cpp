@@ -2,6 +2,7 @@
 #include "../loofah_config.h"
 
 #include <assert.h>
+#include <string.h> // for ::memcpy()
 #include <algorithm> // for std::min()
 
 #include <nut/rc/rc_new.h>
@@ -30,6 +31,16 @@ SockStream& ReactPackageChannel::get_sock_stream() noexcept
     return _sock_stream;
 }
 
+void ReactPackageChannel::set_shared_read_buffer(bool enabled) noexcept
+{
+    _shared_read_buffer = enabled;
+}
+
+bool ReactPackageChannel::is_shared_read_buffer() const noexcept
+{
+    return _shared_read_buffer;
+}
+
 void ReactPackageChannel::open(socket_t fd) noexcept
 {
     NUT_DEBUGGING_ASSERT_ALIVE;
@@ -45,8 +56,13 @@ void ReactPackageChannel::handle_channel_connected() noexcept
 
     Reactor *const reactor = (Reactor*) _poller;
     reactor->register_handler(this, ReactHandler::READ_MASK | ReactHandler::WRITE_MASK);
-    reactor->disable_handler(this, ReactHandler::WRITE_MASK);
+    // NOTE edge-triggered 模式下 WRITE_MASK 始终开启
+    if (!reactor->is_edge_triggered())
+        reactor->disable_handler(this, ReactHandler::WRITE_MASK);
+    if (_reading_paused)
+        reactor->disable_handler(this, ReactHandler::READ_MASK);
 
+    start_timeout_timers();
     handle_connected();
 }
 
@@ -89,6 +105,7 @@ void ReactPackageChannel::force_close(int err) noexcept
     if (_sock_stream.is_null())
         return;
     cancel_force_close_timer();
+    cancel_timeout_timers();
     ((Reactor*) _poller)->unregister_handler(this);
     _sock_stream.close();
 
@@ -114,14 +131,74 @@ void ReactPackageChannel::handle_read_ready() noexcept
     assert(nullptr != _poller && _poller->is_in_io_thread());
 
     Reactor *const reactor = (Reactor*) _poller;
+    const size_t read_budget = (0 != _read_budget ? _read_budget : reactor->get_read_quota());
+    size_t total_readed = 0;
     while (true)
     {
-        if (nullptr == _reading_pkg)
+        // 在 handle_read() 中暂停了读取, 或者关闭了连接
+        if (_reading_paused || _sock_stream.is_null() || _sock_stream.is_reading_shutdown())
+            return;
+
+        // 超出单轮读取字节数, 让给其他连接, 下一轮 poll() 继续读
+        // NOTE level-triggered 模式下会再次报告可读事件; edge-triggered 模式下
+        //      则不会, 由 reactor 记录下来直接继续读
+        if (0 != read_budget && total_readed >= read_budget)
         {
-            _reading_pkg = nut::rc_new<Package>(LOOFAH_INIT_READ_PKG_SIZE);
-            _reading_pkg->raw_rewind();
+            reactor->defer_read_ready(this);
+            return;
         }
-        const ssize_t rs = _sock_stream.read(_reading_pkg->writable_data(), _reading_pkg->writable_size());
+
+        ssize_t rs;
+        size_t pkg_readed = 0; // 本次读入 '_reading_pkg' 可写区域的字节数
+        if (nullptr == _reading_pkg && _shared_read_buffer)
+        {
+            // 先读到共享读缓冲中, 读到数据时才分配自己的读缓冲
+            size_t buf_size = 0;
+            void *const buf = reactor->get_shared_read_buffer(&buf_size);
+            rs = _sock_stream.read(buf, buf_size);
+            if (rs > 0)
+            {
+                _reading_pkg = new_package(rs);
+                _reading_pkg->raw_rewind();
+                assert(_reading_pkg->writable_size() >= (size_t) rs);
+                ::memcpy(_reading_pkg->writable_data(), buf, rs);
+                pkg_readed = rs;
+            }
+        }
+        else
+        {
+            if (nullptr == _reading_pkg)
+                _reading_pkg = new_reading_package();
+
+#if NUT_PLATFORM_OS_MACOS || NUT_PLATFORM_OS_LINUX
+            // 读缓冲不足时溢出到 reactor 的共享读缓冲中, 一次系统调用读入尽量多
+            // 的 package, 而不必先扩容读缓冲
+            size_t extra_size = 0;
+            void *const extra_buf = reactor->get_shared_read_buffer(&extra_size);
+            void *const bufs[2] = {_reading_pkg->writable_data(), extra_buf};
+            const size_t lens[2] = {_reading_pkg->writable_size(), extra_size};
+            rs = _sock_stream.readv(bufs, lens, 2);
+            if (rs > (ssize_t) lens[0])
+            {
+                // 将溢出部分追加到读缓冲中
+                const size_t overflow = rs - lens[0];
+                _reading_pkg->skip_write(lens[0]);
+                _reading_pkg->ensure_writable_size(overflow);
+                ::memcpy(_reading_pkg->writable_data(), extra_buf, overflow);
+                pkg_readed = overflow;
+            }
+            else if (rs > 0)
+            {
+                pkg_readed = rs;
+            }
+#else
+            // FIXME Windows 下 readv() 返回字节数不可靠, 参看 SockOperation::readv() 的实现
+            rs = _sock_stream.read(_reading_pkg->writable_data(), _reading_pkg->writable_size());
+            if (rs > 0)
+                pkg_readed = rs;
+#endif
+        }
+
         if (0 == rs)
         {
             // Read channel shutdown, usually means peer is closing
@@ -136,6 +213,9 @@ void ReactPackageChannel::handle_read_ready() noexcept
         else if (LOOFAH_ERR_WOULD_BLOCK == rs)
         {
             // All read, next reading will be blocked
+            // NOTE 没有残留半个 package 时释放读缓冲, 空闲连接不占用内存
+            if (nullptr != _reading_pkg && 0 == _reading_pkg->readable_size())
+                _reading_pkg = nullptr;
             return;
         }
         else if (rs < 0)
@@ -147,10 +227,26 @@ void ReactPackageChannel::handle_read_ready() noexcept
         }
 
         // Even if in closing, handle_read() should be called
-        split_and_handle_packages((size_t) rs);
+        total_readed += rs;
+        adapt_read_pkg_size(rs);
+        split_and_handle_packages(pkg_readed);
     }
 }
 
+void ReactPackageChannel::stop_reading() noexcept
+{
+    if (nullptr != _registered_reactor)
+        ((Reactor*) _poller)->disable_handler(this, ReactHandler::READ_MASK);
+}
+
+void ReactPackageChannel::start_reading() noexcept
+{
+    // NOTE edge-triggered 模式下重新开启 READ_MASK 会重新检查可读状态, 不会丢失
+    //      暂停期间到达的数据
+    if (nullptr != _registered_reactor)
+        ((Reactor*) _poller)->enable_handler(this, ReactHandler::READ_MASK);
+}
+
 void ReactPackageChannel::write(Package *pkg) noexcept
 {
     assert(nullptr != pkg);
@@ -165,9 +261,80 @@ void ReactPackageChannel::write(Package *pkg) noexcept
     }
 
     pkg->raw_pack();
-    _pkg_write_queue.push_back(pkg);
-    if (1 == _pkg_write_queue.size())
-        ((Reactor*) _poller)->enable_handler(this, ReactHandler::WRITE_MASK);
+    push_write_queue(pkg);
+}
+
+void ReactPackageChannel::start_writing() noexcept
+{
+    // 写队列原本为空, 先尝试直接写出, 省去一次 epoll_ctl() 和一次轮询
+    // NOTE 关闭流程以及写出错都交给 handle_write_ready() 处理, 避免在 write()
+    //      中触发 handle_closed()
+    const bool closing = _closing.load(std::memory_order_relaxed);
+    ssize_t rs = 0;
+    if (!closing)
+        rs = write_directly();
+    if (_pkg_write_queue.empty() && !closing)
+        return;
+
+    // NOTE edge-triggered 模式下 WRITE_MASK 始终开启: 遇到 LOOFAH_ERR_WOULD_BLOCK
+    //      说明发送缓冲已满, 腾出空间后会有新的可写事件; 关闭流程以及写出错则不
+    //      会有新的可写事件, 需要交给 handle_write_ready() 处理
+    Reactor *const reactor = (Reactor*) _poller;
+    if (!reactor->is_edge_triggered())
+    {
+        reactor->enable_handler(this, ReactHandler::WRITE_MASK);
+    }
+    else if (closing)
+    {
+        handle_write_ready();
+    }
+    else if (LOOFAH_ERR_WOULD_BLOCK != rs)
+    {
+        nut::rc_ptr<ReactPackageChannel> ref_this(this);
+        _poller->run_later([=] {
+            if (!ref_this->_sock_stream.is_null())
+                ref_this->handle_write_ready();
+        });
+    }
+}
+
+ssize_t ReactPackageChannel::write_directly() noexcept
+{
+    // NOTE 单次写出受 LOOFAH_MAX_WRITE_BUFS, LOOFAH_MAX_WRITE_BYTES 限制, 并且在
+    //      文件片段处中断, 写完一段后继续写, 直到写队列为空或者发送缓冲已满
+    ssize_t rs = 0;
+    while (!_pkg_write_queue.empty())
+    {
+        rs = write_front();
+        if (rs <= 0)
+            break;
+        pop_written_packages(rs);
+    }
+    return rs;
+}
+
+ssize_t ReactPackageChannel::write_front() noexcept
+{
+    assert(!_pkg_write_queue.empty());
+
+    // 文件片段
+    if (is_write_queue_front_file())
+        return send_write_queue_front_file();
+
+#if NUT_PLATFORM_OS_MACOS || NUT_PLATFORM_OS_LINUX
+    // NOTE 写队列过长时分多次写出, 避免超过 IOV_MAX
+    void **bufs = nullptr;
+    size_t *lens = nullptr;
+    const size_t buf_count = prepare_write_bufs(&bufs, &lens);
+    if (1 == buf_count)
+        return _sock_stream.write(bufs[0], lens[0]);
+    return _sock_stream.writev(bufs, lens, buf_count);
+#else
+    // FIXME Windows 下 writev() 返回字节数不可靠, 参看 SockOperation::writev() 的实现
+    Package *pkg = _pkg_write_queue.front().pkg;
+    assert(nullptr != pkg);
+    return _sock_stream.write(pkg->readable_data(), pkg->readable_size());
+#endif
 }
 
 void ReactPackageChannel::handle_write_ready() noexcept
@@ -191,90 +358,31 @@ void ReactPackageChannel::handle_write_ready() noexcept
         }
 #endif
 
-#if NUT_PLATFORM_OS_MACOS || NUT_PLATFORM_OS_LINUX
-        if (1 == _pkg_write_queue.size())
+        const ssize_t rs = write_front();
+        if (rs >= 0)
         {
-#endif
-            Package *pkg = _pkg_write_queue.front();
-            assert(nullptr != pkg);
-            const size_t readable = pkg->readable_size();
-            const ssize_t rs = _sock_stream.write(pkg->readable_data(), readable);
-            if (rs >= 0)
-            {
-                assert(rs <= (ssize_t) readable);
-                if (rs == (ssize_t) readable)
-                    _pkg_write_queue.pop_front();
-                else
-                    pkg->skip_read(rs);
-            }
-            else if (LOOFAH_ERR_WOULD_BLOCK == rs)
-            {
-                // Next writing will be blocked
-                break;
-            }
-            else
-            {
-                // Error
-                reactor->disable_handler(this, ReactHandler::WRITE_MASK);
-                handle_io_error(rs);
-                return;
-            }
-#if NUT_PLATFORM_OS_MACOS || NUT_PLATFORM_OS_LINUX
+            pop_written_packages(rs);
+        }
+        else if (LOOFAH_ERR_WOULD_BLOCK == rs)
+        {
+            // Next writing will be blocked
+            break;
         }
         else
         {
-            const size_t buf_count = _pkg_write_queue.size();
-            void **bufs = (void**) ::alloca(sizeof(void*) * buf_count + sizeof(size_t) * buf_count);
-            size_t *lens = (size_t*) (bufs + buf_count);
-
-            queue_t::const_iterator iter = _pkg_write_queue.begin();
-            for (size_t i = 0; i < buf_count; ++i, ++iter)
-            {
-                Package *pkg = *iter;
-                assert(nullptr != pkg);
-                bufs[i] = (void*) pkg->readable_data();
-                lens[i] = pkg->readable_size();
-            }
-
-            // FIXME Windows 下 writev() 返回字节数不可靠, 参看 SockOperation::writev() 的实现
-            ssize_t rs = _sock_stream.writev(bufs, lens, buf_count);
-            while (rs > 0)
-            {
-                assert(!_pkg_write_queue.empty());
-                Package *pkg = _pkg_write_queue.front();
-                assert(nullptr != pkg);
-                const size_t readable = pkg->readable_size();
-                if (rs >= (ssize_t) readable)
-                {
-                    _pkg_write_queue.pop_front();
-                    rs -= readable;
-                }
-                else
-                {
-                    pkg->skip_read(rs);
-                    rs = 0;
-                }
-            }
-            if (LOOFAH_ERR_WOULD_BLOCK == rs)
-            {
-                // Next writing will be blocked
-                break;
-            }
-            else if (rs < 0)
-            {
-                // Error
-                reactor->disable_handler(this, ReactHandler::WRITE_MASK);
-                handle_io_error(rs);
-                return;
-            }
+            // Error
+            reactor->disable_handler(this, ReactHandler::WRITE_MASK);
+            handle_io_error(rs);
+            return;
         }
-#endif
     }
 
     if (_pkg_write_queue.empty())
     {
         // 如果本地写队列空了，关闭写
-        reactor->disable_handler(this, ReactHandler::WRITE_MASK);
+        // NOTE edge-triggered 模式下 WRITE_MASK 始终开启, 省去 epoll_ctl() 调用
+        if (!reactor->is_edge_triggered())
+            reactor->disable_handler(this, ReactHandler::WRITE_MASK);
 
         // 如果本地写队列空了，并且处于关闭流程中，则关闭写通道
         if (_sock_stream.is_reading_shutdown())
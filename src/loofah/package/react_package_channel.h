@@ -26,6 +26,19 @@ public:
 
     virtual SockStream& get_sock_stream() noexcept final override;
 
+    /**
+     * 设置是否先读到 reactor 的共享读缓冲中
+     *
+     * 开启后, 没有残留半个 package 的连接读到数据时才分配自己的读缓冲并拷贝,
+     * 被唤醒却读不到数据时不必分配读缓冲, 适合大量空闲连接的场景; 代价是每次
+     * 从头开始读时多一次拷贝
+     *
+     * NOTE 默认关闭; 关闭时空闲连接同样不持有读缓冲, 只是每次读取前先分配,
+     *      读不到数据时再释放
+     */
+    void set_shared_read_buffer(bool enabled) noexcept;
+    bool is_shared_read_buffer() const noexcept;
+
     /**
      * 写数据
      */
@@ -50,8 +63,23 @@ public:
     virtual void handle_io_error(int err) noexcept final override;
 
 private:
+    virtual void start_writing() noexcept final override;
+
+    virtual void stop_reading() noexcept final override;
+    virtual void start_reading() noexcept final override;
+
+    // 尝试不经过轮询直接写出, 返回最后一次写出的结果, 同 SockStream::write()
+    ssize_t write_directly() noexcept;
+
+    // 写出写队列头部的数据, 返回值同 SockStream::write()
+    ssize_t write_front() noexcept;
+
     // 关闭连接
     virtual void force_close(int err) noexcept final override;
+
+private:
+    // 是否先读到 reactor 的共享读缓冲中
+    bool _shared_read_buffer = false;
 };
 
 }
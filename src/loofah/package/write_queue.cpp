@@ -0,0 +1,103 @@
+﻿
+#include "../loofah_config.h"
+
+#include <utility> // for std::move()
+
+#include "write_queue.h"
+
+
+namespace loofah
+{
+
+WriteQueue::~WriteQueue() noexcept
+{
+    if (_entries != _inline_entries)
+        delete[] _entries;
+}
+
+void WriteQueue::push_back(WriteEntry&& entry) noexcept
+{
+    if (_size == _capacity)
+        grow();
+
+    _bytes += entry.size();
+    _entries[(_head + _size) & (_capacity - 1)] = std::move(entry);
+    ++_size;
+}
+
+void WriteQueue::push_front(WriteEntry&& entry) noexcept
+{
+    if (_size == _capacity)
+        grow();
+
+    _bytes += entry.size();
+    _head = (_head + _capacity - 1) & (_capacity - 1);
+    _entries[_head] = std::move(entry);
+    ++_size;
+}
+
+void WriteQueue::pop_front() noexcept
+{
+    assert(_size > 0);
+
+    WriteEntry& entry = _entries[_head];
+    const size_t remaining = entry.size();
+    assert(_bytes >= remaining);
+    _bytes -= remaining;
+    entry.pkg = nullptr;
+    entry.file = nullptr;
+
+    _head = (_head + 1) & (_capacity - 1);
+    if (0 == --_size)
+    {
+        _head = 0;
+        release_heap();
+    }
+}
+
+void WriteQueue::skip_front(size_t len) noexcept
+{
+    WriteEntry& entry = front();
+    assert(len <= entry.size() && _bytes >= len);
+    if (nullptr != entry.pkg)
+        entry.pkg->skip_read(len);
+    else
+        entry.file->skip(len);
+    _bytes -= len;
+}
+
+void WriteQueue::clear() noexcept
+{
+    while (_size > 0)
+        pop_front();
+    assert(0 == _bytes);
+}
+
+void WriteQueue::grow() noexcept
+{
+    assert(_size == _capacity);
+
+    const size_t new_capacity = _capacity * 2;
+    WriteEntry *new_entries = new WriteEntry[new_capacity];
+    for (size_t i = 0; i < _size; ++i)
+        new_entries[i] = std::move(_entries[(_head + i) & (_capacity - 1)]);
+
+    if (_entries != _inline_entries)
+        delete[] _entries;
+    _entries = new_entries;
+    _capacity = new_capacity;
+    _head = 0;
+}
+
+void WriteQueue::release_heap() noexcept
+{
+    assert(0 == _size);
+
+    if (_entries == _inline_entries)
+        return;
+    delete[] _entries;
+    _entries = _inline_entries;
+    _capacity = INLINE_CAPACITY;
+}
+
+}
@@ -0,0 +1,123 @@
+﻿
+#ifndef ___HEADFILE_4E7B7775_322F_4D75_80A8_18D0F1923994_
+#define ___HEADFILE_4E7B7775_322F_4D75_80A8_18D0F1923994_
+
+#include "../loofah_config.h"
+
+#include <assert.h>
+#include <stddef.h> // for size_t
+
+#include <nut/rc/rc_ptr.h>
+
+#include "package.h"
+#include "file_region.h"
+
+
+namespace loofah
+{
+
+/**
+ * 写队列元素, 为 package 或者文件片段
+ */
+struct WriteEntry
+{
+    nut::rc_ptr<Package> pkg;
+    nut::rc_ptr<FileRegion> file;
+
+    size_t size() const noexcept
+    {
+        return nullptr != pkg ? pkg->readable_size() : file->remaining_size();
+    }
+};
+
+/**
+ * 写队列, 环形缓冲实现, 同时统计队列中尚未写出的总字节数
+ *
+ * 元素个数不超过 LOOFAH_WRITE_QUEUE_INLINE_CAPACITY 时直接使用内联存储, 队列
+ * 较深时才在堆上分配, 排空后释放回到内联存储
+ */
+class LOOFAH_API WriteQueue
+{
+public:
+    static constexpr size_t INLINE_CAPACITY = LOOFAH_WRITE_QUEUE_INLINE_CAPACITY;
+    static_assert(0 == (INLINE_CAPACITY & (INLINE_CAPACITY - 1)),
+                  "inline capacity must be power of 2");
+
+public:
+    WriteQueue() = default;
+    ~WriteQueue() noexcept;
+
+    bool empty() const noexcept
+    {
+        return 0 == _size;
+    }
+
+    size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    /**
+     * 队列中尚未写出的总字节数
+     */
+    size_t bytes() const noexcept
+    {
+        return _bytes;
+    }
+
+    WriteEntry& front() noexcept
+    {
+        assert(_size > 0);
+        return _entries[_head];
+    }
+
+    const WriteEntry& front() const noexcept
+    {
+        assert(_size > 0);
+        return _entries[_head];
+    }
+
+    /**
+     * 从队列头开始的第 index 个元素
+     */
+    const WriteEntry& operator[](size_t index) const noexcept
+    {
+        assert(index < _size);
+        return _entries[(_head + index) & (_capacity - 1)];
+    }
+
+    void push_back(WriteEntry&& entry) noexcept;
+    void push_front(WriteEntry&& entry) noexcept;
+    void pop_front() noexcept;
+
+    /**
+     * 队列头部元素已写出 len 字节
+     *
+     * NOTE len 不能超过队列头部元素的剩余字节数
+     */
+    void skip_front(size_t len) noexcept;
+
+    void clear() noexcept;
+
+private:
+    WriteQueue(const WriteQueue&) = delete;
+    WriteQueue& operator=(const WriteQueue&) = delete;
+
+    // 容量翻倍, 元素从下标 0 开始重新排列
+    void grow() noexcept;
+
+    // 排空后释放堆存储
+    void release_heap() noexcept;
+
+private:
+    WriteEntry _inline_entries[INLINE_CAPACITY];
+    WriteEntry *_entries = _inline_entries;
+    size_t _capacity = INLINE_CAPACITY;
+    size_t _head = 0, _size = 0;
+
+    size_t _bytes = 0;
+};
+
+}
+
+#endif
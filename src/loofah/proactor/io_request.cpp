@@ -12,13 +12,29 @@
 namespace loofah
 {
 
+namespace
+{
+
+/**
+ * 能容纳 buf_count 个缓冲区的最小桶; 超过最大桶返回 BUCKET_COUNT
+ */
+size_t bucket_of(size_t buf_count) noexcept
+{
+    size_t bucket = 0;
+    while (bucket < IORequestPool::BUCKET_COUNT && (((size_t) 1) << bucket) < buf_count)
+        ++bucket;
+    return bucket;
+}
+
+}
+
 #if NUT_PLATFORM_OS_WINDOWS
 IORequest::IORequest(ProactHandler *handler_, ProactHandler::mask_type event_type_,
-                     size_t buf_count_, socket_t accept_socket_) noexcept
+                     size_t buf_count_, size_t buf_capacity_, socket_t accept_socket_) noexcept
     : handler(handler_), event_type(event_type_), accept_socket(accept_socket_),
-      buf_count(buf_count_)
+      buf_count(buf_count_), buf_capacity(buf_capacity_)
 {
-    assert(nullptr != handler_);
+    assert(nullptr != handler_ && buf_count_ <= buf_capacity_);
     assert(ProactHandler::ACCEPT_MASK == event_type_ ||
            ProactHandler::CONNECT_MASK == event_type_ ||
            ProactHandler::READ_MASK == event_type_ ||
@@ -26,14 +42,33 @@ IORequest::IORequest(ProactHandler *handler_, ProactHandler::mask_type event_typ
     ::memset(&overlapped, 0, sizeof(overlapped));
 }
 #else
-IORequest::IORequest(ProactHandler::mask_type event_type_, size_t buf_count_) noexcept
-    : event_type(event_type_), buf_count(buf_count_)
+IORequest::IORequest(ProactHandler *handler_, ProactHandler::mask_type event_type_,
+                     size_t buf_count_, size_t buf_capacity_) noexcept
+    : handler(handler_), event_type(event_type_), buf_count(buf_count_),
+      buf_capacity(buf_capacity_)
 {
-    assert(ProactHandler::READ_MASK == event_type_ ||
+    assert(nullptr != handler_ && buf_count_ <= buf_capacity_);
+    assert(ProactHandler::ACCEPT_MASK == event_type_ ||
+           ProactHandler::CONNECT_MASK == event_type_ ||
+           ProactHandler::READ_MASK == event_type_ ||
            ProactHandler::WRITE_MASK == event_type_);
 }
 #endif
 
+IORequest* IORequest::alloc_request(size_t buf_capacity) noexcept
+{
+    assert(buf_capacity > 0);
+
+#if NUT_PLATFORM_OS_WINDOWS
+    const size_t size = sizeof(IORequest) + sizeof(WSABUF) * (buf_capacity - 1);
+#else
+    const size_t size = sizeof(IORequest) + sizeof(struct iovec) * (buf_capacity - 1);
+#endif
+    IORequest *p = (IORequest*) ::malloc(size);
+    assert(nullptr != p);
+    return p;
+}
+
 #if NUT_PLATFORM_OS_WINDOWS
 IORequest* IORequest::new_request(
     ProactHandler *handler, ProactHandler::mask_type event_type, size_t buf_count,
@@ -41,19 +76,20 @@ IORequest* IORequest::new_request(
 {
     assert(nullptr != handler);
 
-    const size_t size = sizeof(IORequest) + sizeof(WSABUF) * (std::max((size_t) 1, buf_count) - 1);
-    IORequest *p = (IORequest*) ::malloc(size);
-    assert(nullptr != p);
-    new (p) IORequest(handler, event_type, buf_count, accept_socket);
+    const size_t buf_capacity = std::max((size_t) 1, buf_count);
+    IORequest *p = alloc_request(buf_capacity);
+    new (p) IORequest(handler, event_type, buf_count, buf_capacity, accept_socket);
     return p;
 }
 #else
-IORequest* IORequest::new_request(ProactHandler::mask_type event_type, size_t buf_count) noexcept
+IORequest* IORequest::new_request(ProactHandler *handler, ProactHandler::mask_type event_type,
+                                  size_t buf_count) noexcept
 {
-    const size_t size = sizeof(IORequest) + sizeof(struct iovec) * (std::max((size_t) 1, buf_count) - 1);
-    IORequest *p = (IORequest*) ::malloc(size);
-    assert(nullptr != p);
-    new (p) IORequest(event_type, buf_count);
+    assert(nullptr != handler);
+
+    const size_t buf_capacity = std::max((size_t) 1, buf_count);
+    IORequest *p = alloc_request(buf_capacity);
+    new (p) IORequest(handler, event_type, buf_count, buf_capacity);
     return p;
 }
 #endif
@@ -94,4 +130,79 @@ void IORequest::set_bufs(void* const *buf_ptrs, const size_t *len_ptrs) noexcept
     }
 }
 
+
+IORequestPool::~IORequestPool() noexcept
+{
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        for (IORequest *p : _free_lists[i])
+            ::free(p);
+        _free_lists[i].clear();
+    }
+}
+
+#if NUT_PLATFORM_OS_WINDOWS
+IORequest* IORequestPool::acquire(
+    ProactHandler *handler, ProactHandler::mask_type event_type, size_t buf_count,
+    socket_t accept_socket) noexcept
+#else
+IORequest* IORequestPool::acquire(ProactHandler *handler, ProactHandler::mask_type event_type,
+                                  size_t buf_count) noexcept
+#endif
+{
+    assert(nullptr != handler);
+
+    const size_t bucket = bucket_of(buf_count);
+    if (bucket >= BUCKET_COUNT)
+    {
+#if NUT_PLATFORM_OS_WINDOWS
+        return IORequest::new_request(handler, event_type, buf_count, accept_socket);
+#else
+        return IORequest::new_request(handler, event_type, buf_count);
+#endif
+    }
+
+    IORequest *p = nullptr;
+    std::vector<IORequest*>& free_list = _free_lists[bucket];
+    if (!free_list.empty())
+    {
+        p = free_list.back();
+        free_list.pop_back();
+    }
+    else
+    {
+        p = IORequest::alloc_request(((size_t) 1) << bucket);
+    }
+
+#if NUT_PLATFORM_OS_WINDOWS
+    new (p) IORequest(handler, event_type, buf_count, ((size_t) 1) << bucket, accept_socket);
+#else
+    new (p) IORequest(handler, event_type, buf_count, ((size_t) 1) << bucket);
+#endif
+    return p;
+}
+
+void IORequestPool::release(IORequest *p) noexcept
+{
+    assert(nullptr != p);
+
+    const size_t bucket = bucket_of(p->buf_capacity);
+    if (bucket < BUCKET_COUNT && (((size_t) 1) << bucket) == p->buf_capacity &&
+        _free_lists[bucket].size() < LOOFAH_IO_REQUEST_POOL_MAX_CACHED)
+    {
+        p->~IORequest();
+        _free_lists[bucket].push_back(p);
+        return;
+    }
+    IORequest::delete_request(p);
+}
+
+size_t IORequestPool::get_cached_count() const noexcept
+{
+    size_t ret = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+        ret += _free_lists[i].size();
+    return ret;
+}
+
 }
@@ -6,6 +6,8 @@
 
 #include <string.h> // for size_t
 
+#include <vector>
+
 #include <nut/platform/platform.h>
 
 #if NUT_PLATFORM_OS_WINDOWS
@@ -23,13 +25,16 @@ namespace loofah
 
 class IORequest
 {
+    friend class IORequestPool;
+
 public:
 #if NUT_PLATFORM_OS_WINDOWS
     static IORequest* new_request(
         ProactHandler *handler, ProactHandler::mask_type event_type,
         size_t buf_count = 0, socket_t accept_socket = LOOFAH_INVALID_SOCKET_FD) noexcept;
 #else
-    static IORequest* new_request(ProactHandler::mask_type event_type, size_t buf_count = 0) noexcept;
+    static IORequest* new_request(ProactHandler *handler, ProactHandler::mask_type event_type,
+                                  size_t buf_count = 0) noexcept;
 #endif
 
     static void delete_request(IORequest *p) noexcept;
@@ -40,11 +45,14 @@ public:
 private:
 #if NUT_PLATFORM_OS_WINDOWS
     IORequest(ProactHandler *handler, ProactHandler::mask_type event_type_,
-              size_t buf_count_, socket_t accept_socket_) noexcept;
+              size_t buf_count_, size_t buf_capacity_, socket_t accept_socket_) noexcept;
 #else
-    IORequest(ProactHandler::mask_type event_type_, size_t buf_count_) noexcept;
+    IORequest(ProactHandler *handler, ProactHandler::mask_type event_type_,
+              size_t buf_count_, size_t buf_capacity_) noexcept;
 #endif
 
+    static IORequest* alloc_request(size_t buf_capacity) noexcept;
+
     IORequest(const IORequest&) = delete;
     IORequest& operator=(const IORequest&) = delete;
 
@@ -58,6 +66,9 @@ public:
     // Handler
     ProactHandler *const handler = nullptr;
 
+    // 所在请求队列中的下一个请求, 参见 IORequestQueue
+    IORequest *next = nullptr;
+
     // 事件类型
     const ProactHandler::mask_type event_type = 0;
 
@@ -66,19 +77,82 @@ public:
 
     const size_t buf_count = 0;
 
+    // wsabufs 实际分配的容量
+    const size_t buf_capacity = 1;
+
     // NOTE 这一部分是变长的，应该作为最后一个成员
     WSABUF wsabufs[1];
 #else
+    // Handler
+    // NOTE io_uring 实现中, handler 注销时尚未完成的请求会被置为 nullptr, 等待
+    //      完成事件到达后再释放
+    ProactHandler *handler = nullptr;
+
+#   if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+    // 孤立请求持有原 handler 的引用, 保证内核完成请求之前缓冲区仍然有效
+    nut::rc_ptr<ProactHandler> orphan_owner;
+#   endif
+
+    // 所在请求队列中的下一个请求, 参见 IORequestQueue
+    IORequest *next = nullptr;
+
     // 事件类型
     const ProactHandler::mask_type event_type = 0;
 
     const size_t buf_count = 0;
 
+    // iovs 实际分配的容量
+    const size_t buf_capacity = 1;
+
     // NOTE 这一部分是变长的，应该作为最后一个成员
     struct iovec iovs[1];
 #endif
 };
 
+/**
+ * IORequest 池, 按照缓冲区个数分桶缓存已完成的请求
+ *
+ * 每个桶的缓冲区容量依次为 1, 2, 4, 8, 16; 请求完成后回收到对应的桶中, 下次发
+ * 起 IO 时直接复用, 避免每次 IO 操作都要 malloc()/free()
+ *
+ * NOTE
+ * - 每个 proactor 一个池, 只能在 IO 线程中使用
+ * - 超过最大桶容量的请求不经过池, 直接分配和释放
+ * - 池中分配的请求也可以直接用 IORequest::delete_request() 释放
+ */
+class IORequestPool
+{
+public:
+    static constexpr size_t BUCKET_COUNT = 5;
+
+public:
+    IORequestPool() = default;
+    ~IORequestPool() noexcept;
+
+#if NUT_PLATFORM_OS_WINDOWS
+    IORequest* acquire(
+        ProactHandler *handler, ProactHandler::mask_type event_type,
+        size_t buf_count = 0, socket_t accept_socket = LOOFAH_INVALID_SOCKET_FD) noexcept;
+#else
+    IORequest* acquire(ProactHandler *handler, ProactHandler::mask_type event_type,
+                       size_t buf_count = 0) noexcept;
+#endif
+
+    void release(IORequest *p) noexcept;
+
+    /**
+     * 当前缓存的空闲请求数
+     */
+    size_t get_cached_count() const noexcept;
+
+private:
+    IORequestPool(const IORequestPool&) = delete;
+    IORequestPool& operator=(const IORequestPool&) = delete;
+
+private:
+    std::vector<IORequest*> _free_lists[BUCKET_COUNT];
+};
+
 }
 
 #endif
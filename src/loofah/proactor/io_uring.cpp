@@ -0,0 +1,298 @@
+﻿
+#include "../loofah_config.h"
+
+#include <nut/platform/platform.h>
+
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+
+#include <assert.h>
+#include <string.h> // for ::memset()
+#include <signal.h> // for _NSIG
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h> // for ::close()
+#include <errno.h>
+
+#include <nut/logging/logger.h>
+
+#include "../inet_base/error.h"
+#include "io_uring.h"
+
+
+#define TAG "loofah.proactor.io_uring"
+
+namespace loofah
+{
+
+namespace
+{
+
+template <typename T>
+T load_acquire(const T *p) noexcept
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+void store_release(T *p, T v) noexcept
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+}
+
+IOUring::~IOUring() noexcept
+{
+    shutdown();
+}
+
+bool IOUring::initialize(unsigned entries) noexcept
+{
+    assert(_ring_fd < 0);
+
+    struct io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+    _ring_fd = (int) ::syscall(__NR_io_uring_setup, entries, &params);
+    if (_ring_fd < 0)
+    {
+        NUT_LOG_W(TAG, "io_uring not available, errno %d: %s", errno, ::strerror(errno));
+        return false;
+    }
+    _features = params.features;
+
+    // NOTE
+    // - IORING_OP_ACCEPT, IORING_OP_ASYNC_CANCEL 等操作需要 Linux 5.5+, 以同版本
+    //   引入的 IORING_FEAT_NODROP 作为判断依据
+    // - 我们的 socket 都是非阻塞的, 没有 IORING_FEAT_FAST_POLL (Linux 5.7+) 时,
+    //   没有数据的读写/accept 请求会直接以 -EAGAIN 完成, 而不是等待就绪
+    if (0 == (_features & IORING_FEAT_NODROP) || 0 == (_features & IORING_FEAT_FAST_POLL))
+    {
+        NUT_LOG_W(TAG, "io_uring of current kernel is too old, features 0x%x", _features);
+        shutdown();
+        return false;
+    }
+
+    // Map rings
+    _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (0 != (_features & IORING_FEAT_SINGLE_MMAP))
+    {
+        if (_cq_ring_size > _sq_ring_size)
+            _sq_ring_size = _cq_ring_size;
+        _cq_ring_size = _sq_ring_size;
+    }
+    _sq_ring = ::mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == _sq_ring)
+    {
+        LOOFAH_LOG_FD_ERRNO(mmap, _ring_fd);
+        _sq_ring = nullptr;
+        shutdown();
+        return false;
+    }
+    if (0 != (_features & IORING_FEAT_SINGLE_MMAP))
+    {
+        _cq_ring = _sq_ring;
+    }
+    else
+    {
+        _cq_ring = ::mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == _cq_ring)
+        {
+            LOOFAH_LOG_FD_ERRNO(mmap, _ring_fd);
+            _cq_ring = nullptr;
+            shutdown();
+            return false;
+        }
+    }
+    _sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    _sqes = (struct io_uring_sqe*) ::mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES);
+    if (MAP_FAILED == (void*) _sqes)
+    {
+        LOOFAH_LOG_FD_ERRNO(mmap, _ring_fd);
+        _sqes = nullptr;
+        shutdown();
+        return false;
+    }
+
+    uint8_t *const sq = (uint8_t*) _sq_ring;
+    _sq_head = (uint32_t*) (sq + params.sq_off.head);
+    _sq_tail = (uint32_t*) (sq + params.sq_off.tail);
+    _sq_mask = *(const uint32_t*) (sq + params.sq_off.ring_mask);
+    _sq_entries = *(const uint32_t*) (sq + params.sq_off.ring_entries);
+    _sq_array = (uint32_t*) (sq + params.sq_off.array);
+    _sqe_tail = *_sq_tail;
+
+    uint8_t *const cq = (uint8_t*) _cq_ring;
+    _cq_head = (uint32_t*) (cq + params.cq_off.head);
+    _cq_tail = (uint32_t*) (cq + params.cq_off.tail);
+    _cq_mask = *(const uint32_t*) (cq + params.cq_off.ring_mask);
+    _cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+
+    return true;
+}
+
+void IOUring::shutdown() noexcept
+{
+    if (nullptr != _sqes)
+        ::munmap(_sqes, _sqes_size);
+    _sqes = nullptr;
+    if (nullptr != _cq_ring && _cq_ring != _sq_ring)
+        ::munmap(_cq_ring, _cq_ring_size);
+    _cq_ring = nullptr;
+    if (nullptr != _sq_ring)
+        ::munmap(_sq_ring, _sq_ring_size);
+    _sq_ring = nullptr;
+
+    if (_ring_fd >= 0)
+    {
+        if (0 != ::close(_ring_fd))
+            LOOFAH_LOG_ERRNO(close);
+    }
+    _ring_fd = -1;
+}
+
+bool IOUring::is_valid() const noexcept
+{
+    return _ring_fd >= 0;
+}
+
+unsigned IOUring::pending_submission() const noexcept
+{
+    return _sqe_tail - load_acquire(_sq_head);
+}
+
+bool IOUring::has_cqe() const noexcept
+{
+    return *_cq_head != load_acquire(_cq_tail);
+}
+
+struct io_uring_sqe* IOUring::get_sqe() noexcept
+{
+    assert(is_valid());
+
+    if (pending_submission() >= _sq_entries)
+    {
+        // 提交队列已满, 先提交
+        const int rs = submit();
+        if (rs < 0 || pending_submission() >= _sq_entries)
+        {
+            NUT_LOG_E(TAG, "io_uring submission queue overflow, fd %d", _ring_fd);
+            return nullptr;
+        }
+    }
+
+    const uint32_t index = _sqe_tail & _sq_mask;
+    struct io_uring_sqe *sqe = _sqes + index;
+    ::memset(sqe, 0, sizeof(struct io_uring_sqe));
+    _sq_array[index] = index;
+    ++_sqe_tail;
+    return sqe;
+}
+
+int IOUring::enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+                   const void *arg, size_t arg_size) noexcept
+{
+    while (true)
+    {
+        const int rs = (int) ::syscall(__NR_io_uring_enter, _ring_fd, to_submit,
+                                       min_complete, flags, arg, arg_size);
+        if (rs >= 0)
+            return rs;
+        if (EINTR == errno)
+            continue;
+        return -errno;
+    }
+}
+
+int IOUring::submit() noexcept
+{
+    assert(is_valid());
+
+    store_release(_sq_tail, _sqe_tail);
+    const unsigned to_submit = pending_submission();
+    if (0 == to_submit)
+        return 0;
+    return enter(to_submit, 0, 0, nullptr, 0);
+}
+
+int IOUring::submit_and_wait(int timeout_ms) noexcept
+{
+    assert(is_valid());
+
+    // 已经有完成事件, 不需要等待
+    if (has_cqe())
+    {
+        const int rs = submit();
+        return rs < 0 ? rs : 0;
+    }
+
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    const void *arg = nullptr;
+    size_t arg_size = 0;
+#if defined(IORING_FEAT_EXT_ARG)
+    struct io_uring_getevents_arg ext_arg;
+#endif
+    if (timeout_ms >= 0)
+    {
+        _timeout_ts.tv_sec = timeout_ms / 1000;
+        _timeout_ts.tv_nsec = (timeout_ms % 1000) * 1000 * 1000;
+
+#if defined(IORING_FEAT_EXT_ARG)
+        if (0 != (_features & IORING_FEAT_EXT_ARG))
+        {
+            ::memset(&ext_arg, 0, sizeof(ext_arg));
+            ext_arg.sigmask_sz = _NSIG / 8;
+            ext_arg.ts = (uint64_t) (uintptr_t) &_timeout_ts;
+            flags |= IORING_ENTER_EXT_ARG;
+            arg = &ext_arg;
+            arg_size = sizeof(ext_arg);
+        }
+        else
+#endif
+        {
+            // NOTE 超时事件在有任何一个其他完成事件时也会结束, 不会堆积
+            struct io_uring_sqe *sqe = get_sqe();
+            if (nullptr == sqe)
+                return -EBUSY;
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = (uint64_t) (uintptr_t) &_timeout_ts;
+            sqe->len = 1;
+            sqe->off = 1; // 完成事件计数
+            sqe->user_data = IO_URING_TIMEOUT_USER_DATA;
+        }
+    }
+
+    store_release(_sq_tail, _sqe_tail);
+    const int rs = enter(pending_submission(), 1, flags, arg, arg_size);
+    if (-ETIME == rs)
+        return 0;
+    return rs < 0 ? rs : 0;
+}
+
+bool IOUring::pop_cqe(uint64_t *user_data, int32_t *res) noexcept
+{
+    assert(is_valid() && nullptr != user_data && nullptr != res);
+
+    while (true)
+    {
+        const uint32_t head = *_cq_head;
+        if (head == load_acquire(_cq_tail))
+            return false;
+
+        const struct io_uring_cqe *cqe = _cqes + (head & _cq_mask);
+        *user_data = cqe->user_data;
+        *res = cqe->res;
+        store_release(_cq_head, head + 1);
+
+        if (IO_URING_TIMEOUT_USER_DATA != *user_data)
+            return true;
+    }
+}
+
+}
+
+#endif /* NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING */
@@ -0,0 +1,121 @@
+﻿
+#ifndef ___HEADFILE_F00FB5EC_6182_4EE4_945B_1A194B8F4471_
+#define ___HEADFILE_F00FB5EC_6182_4EE4_945B_1A194B8F4471_
+
+#include "../loofah_config.h"
+
+#include <nut/platform/platform.h>
+
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+// NOTE Linux 5.7 之前的头文件中没有该定义
+#if !defined(IORING_FEAT_FAST_POLL)
+#   define IORING_FEAT_FAST_POLL (1U << 5)
+#endif
+
+
+// 内部等待超时所用的 user_data, 对应的完成事件不会被 pop_cqe() 返回
+// NOTE IORequest 指针至少是 8 字节对齐的, 不会与之冲突
+#define IO_URING_TIMEOUT_USER_DATA 1
+
+
+namespace loofah
+{
+
+/**
+ * io_uring 的简单封装, 直接使用系统调用, 不依赖 liburing
+ *
+ * NOTE 所有方法都只能在 IO 线程中调用
+ */
+class IOUring
+{
+public:
+    IOUring() = default;
+    ~IOUring() noexcept;
+
+    /**
+     * 创建 io_uring 实例
+     *
+     * @return 内核不支持(Linux 5.7 之前)或者创建失败返回 false
+     */
+    bool initialize(unsigned entries) noexcept;
+    void shutdown() noexcept;
+
+    bool is_valid() const noexcept;
+
+    /**
+     * 获取一个空闲的 submission queue entry, 返回前已经清零
+     *
+     * NOTE 如果提交队列已满, 会先提交已有的 entry
+     *
+     * @return 失败返回 nullptr
+     */
+    struct io_uring_sqe* get_sqe() noexcept;
+
+    /**
+     * 提交所有已准备好的 entry, 不等待完成
+     *
+     * @return >=0 提交的数量; <0 为 -errno
+     */
+    int submit() noexcept;
+
+    /**
+     * 提交所有已准备好的 entry, 并等待至少一个完成事件
+     *
+     * @param timeout_ms <0 无限等待; >=0 等待超时的毫秒数
+     * @return 0 表示正常(包括超时); <0 为 -errno
+     */
+    int submit_and_wait(int timeout_ms) noexcept;
+
+    /**
+     * 取出一个完成事件
+     *
+     * @return 没有完成事件则返回 false
+     */
+    bool pop_cqe(uint64_t *user_data, int32_t *res) noexcept;
+
+private:
+    IOUring(const IOUring&) = delete;
+    IOUring& operator=(const IOUring&) = delete;
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+              const void *arg, size_t arg_size) noexcept;
+    unsigned pending_submission() const noexcept;
+    bool has_cqe() const noexcept;
+
+private:
+    int _ring_fd = -1;
+    uint32_t _features = 0;
+
+    // submission queue
+    void *_sq_ring = nullptr;
+    size_t _sq_ring_size = 0;
+    uint32_t *_sq_head = nullptr;
+    uint32_t *_sq_tail = nullptr;
+    uint32_t _sq_mask = 0;
+    uint32_t _sq_entries = 0;
+    uint32_t *_sq_array = nullptr;
+    struct io_uring_sqe *_sqes = nullptr;
+    size_t _sqes_size = 0;
+    uint32_t _sqe_tail = 0; // 本地已准备的 entry 位置, 提交时同步到 '_sq_tail'
+
+    // completion queue
+    void *_cq_ring = nullptr;
+    size_t _cq_ring_size = 0;
+    uint32_t *_cq_head = nullptr;
+    uint32_t *_cq_tail = nullptr;
+    uint32_t _cq_mask = 0;
+    struct io_uring_cqe *_cqes = nullptr;
+
+    // 不支持 IORING_FEAT_EXT_ARG 时, 使用 IORING_OP_TIMEOUT 实现等待超时
+    struct __kernel_timespec _timeout_ts;
+};
+
+}
+
+#endif /* NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING */
+
+#endif
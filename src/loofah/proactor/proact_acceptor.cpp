@@ -9,6 +9,7 @@
 #include "../inet_base/utils.h"
 #include "../inet_base/sock_operation.h"
 #include "../inet_base/error.h"
+#include "../inet_base/event_loop_group.h"
 #include "proact_acceptor.h"
 #include "proact_channel.h"
 #include "proactor.h"
@@ -96,12 +97,29 @@ socket_t ProactAcceptorBase::get_socket() const noexcept
     return _listening_socket;
 }
 
+void ProactAcceptorBase::set_loop_group(EventLoopGroupBase *loop_group) noexcept
+{
+    _loop_group = loop_group;
+}
+
 void ProactAcceptorBase::handle_accept_completed(socket_t fd) noexcept
 {
     nut::rc_ptr<ProactChannel> channel = create_channel();
-    channel->initialize();
-    channel->open(fd);
-    channel->handle_channel_connected();
+    if (nullptr != _loop_group)
+    {
+        // 分派到其他事件循环中
+        _loop_group->dispatch([=] (PollerBase*) {
+            channel->initialize();
+            channel->open(fd);
+            channel->handle_channel_connected();
+        });
+    }
+    else
+    {
+        channel->initialize();
+        channel->open(fd);
+        channel->handle_channel_connected();
+    }
 
     _registered_proactor->launch_accept(this);
 }
@@ -14,6 +14,7 @@ namespace loofah
 {
 
 class ProactChannel;
+class EventLoopGroupBase;
 
 class LOOFAH_API ProactAcceptorBase : public ProactHandler
 {
@@ -25,6 +26,15 @@ public:
      */
     bool listen(const InetAddr& addr, int listen_num = 2048) noexcept;
 
+    /**
+     * 设置事件循环组, 接收到的连接将分派到组内的事件循环中
+     *
+     * NOTE 分派后, channel 的 initialize() / open() / handle_channel_connected()
+     *      均在目标事件循环线程中调用, initialize() 中可以通过
+     *      EventLoopGroup::current_loop() 获取所在的 poller
+     */
+    void set_loop_group(EventLoopGroupBase *loop_group) noexcept;
+
     virtual socket_t get_socket() const noexcept final override;
     virtual void handle_accept_completed(socket_t fd) noexcept final override;
     virtual void handle_connect_completed() noexcept final override;
@@ -37,6 +47,7 @@ protected:
 
 private:
     socket_t _listening_socket = LOOFAH_INVALID_SOCKET_FD;
+    EventLoopGroupBase *_loop_group = nullptr;
 };
 
 template <typename CHANNEL>
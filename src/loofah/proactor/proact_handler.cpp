@@ -8,19 +8,67 @@
 namespace loofah
 {
 
+void IORequestQueue::push(IORequest *io_request) noexcept
+{
+    assert(nullptr != io_request && nullptr == io_request->next);
+
+    if (nullptr == _tail)
+        _head = io_request;
+    else
+        _tail->next = io_request;
+    _tail = io_request;
+}
+
+void IORequestQueue::pop() noexcept
+{
+    assert(nullptr != _head);
+
+    IORequest *const io_request = _head;
+    _head = io_request->next;
+    if (nullptr == _head)
+        _tail = nullptr;
+    io_request->next = nullptr;
+}
+
+bool IORequestQueue::remove(IORequest *io_request) noexcept
+{
+    assert(nullptr != io_request);
+
+    IORequest *prev = nullptr;
+    for (IORequest *r = _head; nullptr != r; prev = r, r = r->next)
+    {
+        if (r != io_request)
+            continue;
+
+        if (nullptr == prev)
+            _head = r->next;
+        else
+            prev->next = r->next;
+        if (_tail == r)
+            _tail = prev;
+        r->next = nullptr;
+        return true;
+    }
+    return false;
+}
+
 ProactHandler::~ProactHandler() noexcept
 {
+    // NOTE 此时 proactor 可能已经析构, 不能回收到池中
     delete_requests();
 }
 
-void ProactHandler::delete_requests() noexcept
+void ProactHandler::delete_requests(IORequestPool *pool) noexcept
 {
     while (!_read_queue.empty())
     {
         IORequest *io_request = _read_queue.front();
         assert(nullptr != io_request);
         _read_queue.pop();
-        IORequest::delete_request(io_request);
+        if (nullptr != pool)
+            pool->release(io_request);
+        else
+            IORequest::delete_request(io_request);
     }
 
     while (!_write_queue.empty())
@@ -28,7 +76,10 @@ void ProactHandler::delete_requests() noexcept
         IORequest *io_request = _write_queue.front();
         assert(nullptr != io_request);
         _write_queue.pop();
-        IORequest::delete_request(io_request);
+        if (nullptr != pool)
+            pool->release(io_request);
+        else
+            IORequest::delete_request(io_request);
     }
 }
 
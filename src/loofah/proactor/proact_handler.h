@@ -4,8 +4,6 @@
 
 #include "../loofah_config.h"
 
-#include <queue>
-
 #include <nut/platform/platform.h>
 
 #if NUT_PLATFORM_OS_WINDOWS
@@ -20,8 +18,47 @@ namespace loofah
 {
 
 class IORequest;
+class IORequestPool;
 class Proactor;
 
+/**
+ * IORequest 队列, 通过 IORequest::next 串成侵入式单向链表
+ *
+ * NOTE 不需要额外分配内存, 空闲连接只占用两个指针
+ */
+class IORequestQueue
+{
+public:
+    IORequestQueue() = default;
+
+    bool empty() const noexcept
+    {
+        return nullptr == _head;
+    }
+
+    IORequest* front() const noexcept
+    {
+        return _head;
+    }
+
+    void push(IORequest *io_request) noexcept;
+    void pop() noexcept;
+
+    /**
+     * 移除指定请求, 保持其他请求的顺序
+     *
+     * @return 是否找到并移除
+     */
+    bool remove(IORequest *io_request) noexcept;
+
+private:
+    IORequestQueue(const IORequestQueue&) = delete;
+    IORequestQueue& operator=(const IORequestQueue&) = delete;
+
+private:
+    IORequest *_head = nullptr, *_tail = nullptr;
+};
+
 class LOOFAH_API ProactHandler
 {
     NUT_REF_COUNTABLE
@@ -86,8 +123,8 @@ private:
     ProactHandler(const ProactHandler&) = delete;
     ProactHandler& operator=(const ProactHandler&) = delete;
 
-    // 删除所有未完成的 IORequest
-    void delete_requests() noexcept;
+    // 删除所有未完成的 IORequest; pool 不为空则回收到池中
+    void delete_requests(IORequestPool *pool = nullptr) noexcept;
 
 protected:
     Proactor *_registered_proactor = nullptr;
@@ -102,7 +139,7 @@ private:
 #endif
 
     // 读写请求队列
-    std::queue<IORequest*> _read_queue, _write_queue;
+    IORequestQueue _read_queue, _write_queue;
 
     // 用于记录注册状态，参见 Proactor 的实现
 #if NUT_PLATFORM_OS_MACOS
@@ -110,6 +147,10 @@ private:
     mask_type _registered_events = 0;
 #elif NUT_PLATFORM_OS_LINUX
     bool _registered = false;
+    // 已注册到 epoll 中的 READ_MASK, WRITE_MASK
+    mask_type _registered_events = 0;
+    // _enabled_events 有变化, 尚未同步到 epoll 中
+    bool _dirty = false;
 #endif
 };
 
@@ -1,6 +1,7 @@
 ﻿/**
  * 1. 关于 Windows 下的完成端口，参见 http://blog.csdn.net/piggyxp/article/details/6922277
  * 2. 关于 Linux 下 libaio + epoll，参见 http://blog.chinaunix.net/uid-16979052-id-3840266.html
+ * 3. 关于 Linux 下 io_uring，参见 https://kernel.dk/io_uring.pdf
  */
 
 #include "../loofah_config.h"
@@ -22,6 +23,8 @@
 #elif NUT_PLATFORM_OS_LINUX
 #   include <sys/epoll.h>
 #   include <sys/eventfd.h>
+#   include <sys/socket.h> // for SOCK_NONBLOCK
+#   include <poll.h> // for POLLIN
 #   include <unistd.h> // for ::close()
 #   include <errno.h>
 #endif
@@ -39,6 +42,11 @@
 // Magic number
 #define KQUEUE_WAKEUP_IDENT 0
 
+// io_uring 中 eventfd 及取消操作所用的 user_data
+// NOTE IORequest 指针至少是 8 字节对齐的, 不会与之冲突
+#define IO_URING_WAKEUP_USER_DATA 2
+#define IO_URING_CANCEL_USER_DATA 3
+
 #define TAG "loofah.proactor"
 
 namespace loofah
@@ -57,6 +65,19 @@ ProactHandler::mask_type real_mask(ProactHandler::mask_type mask) noexcept
         ret |= ProactHandler::WRITE_MASK;
     return ret;
 }
+
+/**
+ * 请求中所有缓冲区的总字节数
+ */
+size_t iovs_size(const IORequest *io_request) noexcept
+{
+    assert(nullptr != io_request);
+
+    size_t ret = 0;
+    for (size_t i = 0; i < io_request->buf_count; ++i)
+        ret += io_request->iovs[i].iov_len;
+    return ret;
+}
 #endif
 
 }
@@ -84,6 +105,24 @@ Proactor::Proactor() noexcept
     if (0 != ::kevent(_kq, &ev, 1, nullptr, 0, nullptr))
         LOOFAH_LOG_FD_ERRNO(kevent, _kq);
 #elif NUT_PLATFORM_OS_LINUX
+    // Create eventfd
+    _event_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (_event_fd < 0)
+    {
+        LOOFAH_LOG_ERRNO(eventfd);
+        return;
+    }
+
+#   if LOOFAH_USE_IO_URING
+    // Create io_uring, 失败则退回到 epoll 模拟实现
+    if (_io_uring.initialize(LOOFAH_IO_URING_ENTRIES))
+    {
+        arm_io_uring_wakeup();
+        return;
+    }
+    NUT_LOG_W(TAG, "io_uring unavailable, fallback to epoll");
+#   endif
+
     // Create epoll fd
     // NOTE 自从 Linux2.6.8 版本以后，epoll_create() 参数值其实是没什么用的, 只
     //      需要大于 0
@@ -94,14 +133,6 @@ Proactor::Proactor() noexcept
         return;
     }
 
-    // Create eventfd
-    _event_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
-    if (_event_fd < 0)
-    {
-        LOOFAH_LOG_ERRNO(eventfd);
-        return;
-    }
-
     // Register eventfd to epoll fd
     struct epoll_event epv;
     ::memset(&epv, 0, sizeof(epv));
@@ -117,6 +148,13 @@ Proactor::~Proactor() noexcept
     shutdown();
 }
 
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+bool Proactor::is_io_uring_enabled() const noexcept
+{
+    return _io_uring.is_valid();
+}
+#endif
+
 void Proactor::shutdown_later() noexcept
 {
     _closing_or_closed.store(true, std::memory_order_relaxed);
@@ -158,6 +196,40 @@ void Proactor::shutdown() noexcept
     }
     _kq = -1;
 #elif NUT_PLATFORM_OS_LINUX
+#   if LOOFAH_USE_IO_URING
+    // Close io_uring
+    if (_io_uring.is_valid())
+    {
+        // 等待孤立请求完成(一般是被取消), 之后内核不再访问其缓冲区
+        _io_uring.submit();
+        for (int i = 0; i < 100; ++i)
+        {
+            uint64_t user_data = 0;
+            int32_t res = 0;
+            while (_io_uring.pop_cqe(&user_data, &res))
+            {
+                if (IO_URING_WAKEUP_USER_DATA == user_data || IO_URING_CANCEL_USER_DATA == user_data)
+                    continue;
+                IORequest *io_request = (IORequest*) user_data;
+                if (nullptr == io_request->handler)
+                    release_orphan_request(io_request);
+            }
+            if (_orphan_requests.empty() || _io_uring.submit_and_wait(10) < 0)
+                break;
+        }
+        _io_uring.shutdown();
+    }
+
+    // 关闭 io_uring 会取消剩余的请求, 释放尚未等到完成事件的孤立请求
+    for (IORequest *io_request : _orphan_requests)
+        _io_request_pool.release(io_request);
+    _orphan_requests.clear();
+    _released_orphan_owners.clear();
+#   endif
+
+    // 放弃尚未同步的 epoll 变化
+    _dirty_handlers.clear();
+
     // Unregister eventfd from epoll fd
     if (_event_fd >= 0 && _epoll_fd >= 0)
     {
@@ -230,6 +302,7 @@ void Proactor::register_handler(ProactHandler *handler) noexcept
 #endif
 
     handler->_registered_proactor = this;
+    _handler_count.fetch_add(1, std::memory_order_relaxed);
 }
 
 void Proactor::unregister_handler_later(ProactHandler *handler) noexcept
@@ -254,6 +327,7 @@ void Proactor::unregister_handler(ProactHandler *handler) noexcept
     assert(nullptr != handler && handler->_registered_proactor == this);
     assert(is_in_io_thread());
 
+    _handler_count.fetch_sub(1, std::memory_order_relaxed);
 
 #if NUT_PLATFORM_OS_WINDOWS
     // FIXME 对于 Windows 下的 IOCP，是无法取消 socket 与 iocp 的关联的
@@ -264,7 +338,7 @@ void Proactor::unregister_handler(ProactHandler *handler) noexcept
     ::CancelIo((HANDLE) fd); // 取消当前线程注册的尚未完成的异步操作，这里都是在一个线程中发起的异步操作
 #   endif
     handler->_registered_proactor = nullptr;
-    handler->delete_requests();
+    handler->delete_requests(&_io_request_pool);
 #elif NUT_PLATFORM_OS_MACOS
     const socket_t fd = handler->get_socket();
     struct kevent ev[2];
@@ -282,8 +356,20 @@ void Proactor::unregister_handler(ProactHandler *handler) noexcept
     handler->_registered_events = 0;
     handler->_enabled_events = 0;
     handler->_registered_proactor = nullptr;
-    handler->delete_requests();
+    handler->delete_requests(&_io_request_pool);
 #elif NUT_PLATFORM_OS_LINUX
+#   if LOOFAH_USE_IO_URING
+    if (_io_uring.is_valid())
+    {
+        // NOTE 尚未完成的请求不能立即释放, 需要等待其完成事件
+        cancel_io_uring_requests(&handler->_read_queue);
+        cancel_io_uring_requests(&handler->_write_queue);
+        _io_uring.submit();
+        handler->_registered_proactor = nullptr;
+        return;
+    }
+#   endif
+
     if (handler->_registered)
     {
         const socket_t fd = handler->get_socket();
@@ -298,9 +384,11 @@ void Proactor::unregister_handler(ProactHandler *handler) noexcept
         }
     }
     handler->_registered = false;
+    handler->_registered_events = 0;
+    handler->_dirty = false; // NOTE 可能仍在 '_dirty_handlers' 中, 同步时会被跳过
     handler->_enabled_events = 0;
     handler->_registered_proactor = nullptr;
-    handler->delete_requests();
+    handler->delete_requests(&_io_request_pool);
 #endif
 }
 
@@ -339,7 +427,7 @@ void Proactor::launch_accept(ProactHandler *handler) noexcept
     // Call ::AcceptEx()
     // NOTE 'buf' 中存放本地地址、对端地址、首个接收数据(可以是0长度)。且存放地
     //      址的空间必须比所用传输协议的最大地址大16个字节
-    IORequest *io_request = IORequest::new_request(handler, ProactHandler::ACCEPT_MASK, 1, accept_socket);
+    IORequest *io_request = _io_request_pool.acquire(handler, ProactHandler::ACCEPT_MASK, 1, accept_socket);
     assert(nullptr != io_request);
     const size_t buf_len = 2 * (sizeof(struct sockaddr_in) + 16);
     void *buf = ::malloc(2 * (sizeof(struct sockaddr_in) + 16));
@@ -366,13 +454,21 @@ void Proactor::launch_accept(ProactHandler *handler) noexcept
             LOOFAH_LOG_FD_ERRNO(AcceptEx, listening_socket);
             if (0 != ::closesocket(accept_socket))
                 LOOFAH_LOG_FD_ERRNO(closesocket, accept_socket);
-            IORequest::delete_request(io_request);
+            _io_request_pool.release(io_request);
             handler->handle_io_error(from_errno(errcode));
             return;
         }
     }
     handler->_read_queue.push(io_request);
 #elif NUT_PLATFORM_OS_MACOS || NUT_PLATFORM_OS_LINUX
+#   if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+    if (_io_uring.is_valid())
+    {
+        launch_io_uring_request(_io_request_pool.acquire(handler, ProactHandler::ACCEPT_MASK));
+        return;
+    }
+#   endif
+
     ++handler->_request_accept;
     enable_handler(handler, ProactHandler::ACCEPT_MASK);
 #endif
@@ -421,7 +517,7 @@ void Proactor::launch_connect(ProactHandler *handler, const InetAddr& address) n
     assert(nullptr != handler && handler->_registered_proactor == this);
     assert(is_in_io_thread());
 
-    IORequest *io_request = IORequest::new_request(handler, ProactHandler::CONNECT_MASK);
+    IORequest *io_request = _io_request_pool.acquire(handler, ProactHandler::CONNECT_MASK);
     assert(nullptr != io_request);
 
     const socket_t fd = handler->get_socket();
@@ -440,7 +536,7 @@ void Proactor::launch_connect(ProactHandler *handler, const InetAddr& address) n
         if (ERROR_IO_PENDING != errcode)
         {
             LOOFAH_LOG_FD_ERRNO(ConnectEx, fd);
-            IORequest::delete_request(io_request);
+            _io_request_pool.release(io_request);
             handler->handle_io_error(from_errno(errcode));
             return;
         }
@@ -452,6 +548,15 @@ void Proactor::launch_connect(ProactHandler *handler) noexcept
 {
     assert(nullptr != handler && handler->_registered_proactor == this);
     assert(is_in_io_thread());
+
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+    if (_io_uring.is_valid())
+    {
+        launch_io_uring_request(_io_request_pool.acquire(handler, ProactHandler::CONNECT_MASK));
+        return;
+    }
+#endif
+
     assert(0 == (handler->_enabled_events & ProactHandler::CONNECT_MASK));
     enable_handler(handler, ProactHandler::CONNECT_MASK);
 }
@@ -493,7 +598,7 @@ void Proactor::launch_read(ProactHandler *handler, void* const *buf_ptrs,
     assert(is_in_io_thread());
 
 #if NUT_PLATFORM_OS_WINDOWS
-    IORequest *io_request = IORequest::new_request(handler, ProactHandler::READ_MASK, buf_count);
+    IORequest *io_request = _io_request_pool.acquire(handler, ProactHandler::READ_MASK, buf_count);
     assert(nullptr != io_request);
     io_request->set_bufs(buf_ptrs, len_ptrs);
 
@@ -512,17 +617,25 @@ void Proactor::launch_read(ProactHandler *handler, void* const *buf_ptrs,
         if (ERROR_IO_PENDING != errcode)
         {
             LOOFAH_LOG_FD_ERRNO(WSARecv, fd);
-            IORequest::delete_request(io_request);
+            _io_request_pool.release(io_request);
             handler->handle_io_error(from_errno(errcode));
             return;
         }
     }
     handler->_read_queue.push(io_request);
 #elif NUT_PLATFORM_OS_MACOS || NUT_PLATFORM_OS_LINUX
-    IORequest *io_request = IORequest::new_request(ProactHandler::READ_MASK, buf_count);
+    IORequest *io_request = _io_request_pool.acquire(handler, ProactHandler::READ_MASK, buf_count);
     assert(nullptr != io_request);
     io_request->set_bufs(buf_ptrs, len_ptrs);
 
+#   if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+    if (_io_uring.is_valid())
+    {
+        launch_io_uring_request(io_request);
+        return;
+    }
+#   endif
+
     handler->_read_queue.push(io_request);
     enable_handler(handler, ProactHandler::READ_MASK);
 #endif
@@ -563,7 +676,7 @@ void Proactor::launch_write(ProactHandler *handler, void* const *buf_ptrs,
     assert(is_in_io_thread());
 
 #if NUT_PLATFORM_OS_WINDOWS
-    IORequest *io_request = IORequest::new_request(handler, ProactHandler::WRITE_MASK, buf_count);
+    IORequest *io_request = _io_request_pool.acquire(handler, ProactHandler::WRITE_MASK, buf_count);
     assert(nullptr != io_request);
     io_request->set_bufs(buf_ptrs, len_ptrs);
 
@@ -582,17 +695,25 @@ void Proactor::launch_write(ProactHandler *handler, void* const *buf_ptrs,
         if (ERROR_IO_PENDING != errcode)
         {
             LOOFAH_LOG_FD_ERRNO(WSASend, fd);
-            IORequest::delete_request(io_request);
+            _io_request_pool.release(io_request);
             handler->handle_io_error(from_errno(errcode));
             return;
         }
     }
     handler->_write_queue.push(io_request);
 #elif NUT_PLATFORM_OS_MACOS || NUT_PLATFORM_OS_LINUX
-    IORequest *io_request = IORequest::new_request(ProactHandler::WRITE_MASK, buf_count);
+    IORequest *io_request = _io_request_pool.acquire(handler, ProactHandler::WRITE_MASK, buf_count);
     assert(nullptr != io_request);
     io_request->set_bufs(buf_ptrs, len_ptrs);
 
+#   if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+    if (_io_uring.is_valid())
+    {
+        launch_io_uring_request(io_request);
+        return;
+    }
+#   endif
+
     handler->_write_queue.push(io_request);
     enable_handler(handler, ProactHandler::WRITE_MASK);
 #endif
@@ -636,25 +757,13 @@ void Proactor::enable_handler(ProactHandler *handler, ProactHandler::mask_type m
     handler->_registered_events |= need_enable;
     handler->_enabled_events |= mask;
 #elif NUT_PLATFORM_OS_LINUX
-    if (0 != need_enable)
+    UNUSED(fd);
+    handler->_enabled_events |= mask;
+    if (0 != need_enable && !handler->_dirty)
     {
-        struct epoll_event epv;
-        ::memset(&epv, 0, sizeof(epv));
-        epv.data.ptr = (void*) handler;
-        const ProactHandler::mask_type final_enabled = handler->_enabled_events | mask;
-        if (0 != (final_enabled & ProactHandler::ACCEPT_READ_MASK))
-            epv.events |= EPOLLIN | EPOLLERR;
-        if (0 != (final_enabled & ProactHandler::CONNECT_WRITE_MASK))
-            epv.events |= EPOLLOUT | EPOLLERR;
-        if (0 != ::epoll_ctl(_epoll_fd, (handler->_registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD), fd, &epv))
-        {
-            LOOFAH_LOG_FD_ERRNO(epoll_ctl, fd);
-            handler->handle_io_error(from_errno(errno));
-            return;
-        }
+        handler->_dirty = true;
+        _dirty_handlers.push_back(handler);
     }
-    handler->_registered = true;
-    handler->_enabled_events |= mask;
 #endif
 }
 
@@ -685,25 +794,133 @@ void Proactor::disable_handler(ProactHandler *handler, ProactHandler::mask_type
     }
     handler->_enabled_events &= ~mask;
 #elif NUT_PLATFORM_OS_LINUX
-    if (0 != need_disable)
+    UNUSED(fd);
+    handler->_enabled_events &= ~mask;
+    if (0 != need_disable && !handler->_dirty)
     {
-        struct epoll_event epv;
-        ::memset(&epv, 0, sizeof(epv));
-        epv.data.ptr = (void*) handler;
-        const ProactHandler::mask_type final_enabled = handler->_enabled_events & ~mask;
-        if (0 != (final_enabled & ProactHandler::READ_MASK))
-            epv.events |= EPOLLIN | EPOLLERR;
-        if (0 != (final_enabled & ProactHandler::WRITE_MASK))
-            epv.events |= EPOLLOUT | EPOLLERR;
-        if (0 != ::epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, fd, &epv))
+        handler->_dirty = true;
+        _dirty_handlers.push_back(handler);
+    }
+#endif
+}
+#endif
+
+#if NUT_PLATFORM_OS_LINUX
+void Proactor::apply_epoll_changes() noexcept
+{
+    assert(is_in_io_thread());
+
+    // NOTE handle_io_error() 中可能会再次修改 '_dirty_handlers'
+    while (!_dirty_handlers.empty())
+    {
+        _applying_handlers.swap(_dirty_handlers);
+        for (ProactHandler *handler : _applying_handlers)
         {
-            LOOFAH_LOG_FD_ERRNO(epoll_ctl, fd);
-            handler->handle_io_error(from_errno(errno));
-            return;
+            // 已经注销, 或者重复加入
+            if (!handler->_dirty)
+                continue;
+            handler->_dirty = false;
+            assert(handler->_registered_proactor == this);
+
+            const ProactHandler::mask_type final_enabled = real_mask(handler->_enabled_events);
+            if (handler->_registered && final_enabled == handler->_registered_events)
+                continue;
+
+            const socket_t fd = handler->get_socket();
+            struct epoll_event epv;
+            ::memset(&epv, 0, sizeof(epv));
+            epv.data.ptr = (void*) handler;
+            if (0 != (final_enabled & ProactHandler::READ_MASK))
+                epv.events |= EPOLLIN | EPOLLERR;
+            if (0 != (final_enabled & ProactHandler::WRITE_MASK))
+                epv.events |= EPOLLOUT | EPOLLERR;
+            if (0 != ::epoll_ctl(_epoll_fd, (handler->_registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD), fd, &epv))
+            {
+                LOOFAH_LOG_FD_ERRNO(epoll_ctl, fd);
+                handler->handle_io_error(from_errno(errno));
+                continue;
+            }
+            handler->_registered = true;
+            handler->_registered_events = final_enabled;
         }
+        _applying_handlers.clear();
     }
-    handler->_enabled_events &= ~mask;
+}
 #endif
+
+#if NUT_PLATFORM_OS_MACOS || NUT_PLATFORM_OS_LINUX
+size_t Proactor::complete_read_requests(ProactHandler *handler) noexcept
+{
+    assert(nullptr != handler && handler->_registered_proactor == this);
+
+    const socket_t fd = handler->get_socket();
+    size_t completed = 0;
+    while (!handler->_read_queue.empty() && handler->_registered_proactor == this &&
+           completed < LOOFAH_MAX_COMPLETIONS_PER_EVENT)
+    {
+        IORequest *io_request = handler->_read_queue.front();
+        assert(nullptr != io_request);
+        const ssize_t readed = ::readv(fd, io_request->iovs, io_request->buf_count);
+        const int errcode = errno;
+        if (readed < 0 && (EAGAIN == errcode || EWOULDBLOCK == errcode))
+            break; // 请求留在队列中, 等待下一次可读事件
+
+        handler->_read_queue.pop();
+        if (handler->_read_queue.empty())
+            disable_handler(handler, ProactHandler::READ_MASK);
+        const size_t requested = iovs_size(io_request);
+        _io_request_pool.release(io_request);
+        ++completed;
+
+        if (readed < 0)
+        {
+            handler->handle_io_error(from_errno(errcode));
+            break;
+        }
+        handler->handle_read_completed((size_t) readed);
+
+        // 没有读满或者读通道关闭, 说明接收缓冲已经读空
+        if (0 == readed || (size_t) readed < requested)
+            break;
+    }
+    return completed;
+}
+
+size_t Proactor::complete_write_requests(ProactHandler *handler) noexcept
+{
+    assert(nullptr != handler && handler->_registered_proactor == this);
+
+    const socket_t fd = handler->get_socket();
+    size_t completed = 0;
+    while (!handler->_write_queue.empty() && handler->_registered_proactor == this &&
+           completed < LOOFAH_MAX_COMPLETIONS_PER_EVENT)
+    {
+        IORequest *io_request = handler->_write_queue.front();
+        assert(nullptr != io_request);
+        const ssize_t wrote = ::writev(fd, io_request->iovs, io_request->buf_count);
+        const int errcode = errno;
+        if (wrote < 0 && (EAGAIN == errcode || EWOULDBLOCK == errcode))
+            break; // 请求留在队列中, 等待下一次可写事件
+
+        handler->_write_queue.pop();
+        if (handler->_write_queue.empty())
+            disable_handler(handler, ProactHandler::WRITE_MASK);
+        const size_t requested = iovs_size(io_request);
+        _io_request_pool.release(io_request);
+        ++completed;
+
+        if (wrote < 0)
+        {
+            handler->handle_io_error(from_errno(errcode));
+            break;
+        }
+        handler->handle_write_completed((size_t) wrote);
+
+        // 没有写完, 说明发送缓冲已满
+        if ((size_t) wrote < requested)
+            break;
+    }
+    return completed;
 }
 #endif
 
@@ -718,6 +935,12 @@ int Proactor::poll(int timeout_ms) noexcept
         return -1;
     }
 
+    // 等待时间不超过最近的定时器到期时间
+    timeout_ms = get_poll_timeout(timeout_ms);
+
+    // 本轮完成的请求数
+    int completed = 0;
+
 #if NUT_PLATFORM_OS_WINDOWS
     const DWORD timeout = (timeout_ms < 0 ? INFINITE : timeout_ms);
     DWORD bytes_transfered = 0;
@@ -769,7 +992,8 @@ int Proactor::poll(int timeout_ms) noexcept
             assert(io_request == handler->_write_queue.front());
             handler->_write_queue.pop();
         }
-        IORequest::delete_request(io_request);
+        _io_request_pool.release(io_request);
+        completed = 1;
 
         // FIXME 因为 ::GetQueuedCompletionStatus() 不返回底层网络驱动的错误
         //       码，导致低层网络驱动错误码被丢失
@@ -797,6 +1021,7 @@ int Proactor::poll(int timeout_ms) noexcept
             assert(io_request == handler->_write_queue.front());
             handler->_write_queue.pop();
         }
+        completed = 1;
 
         switch (io_request->event_type)
         {
@@ -871,7 +1096,7 @@ int Proactor::poll(int timeout_ms) noexcept
             assert(false);
         }
 
-        IORequest::delete_request(io_request);
+        _io_request_pool.release(io_request);
     }
 #elif NUT_PLATFORM_OS_MACOS
     struct timespec timeout;
@@ -885,11 +1110,13 @@ int Proactor::poll(int timeout_ms) noexcept
         timeout.tv_sec = timeout_ms / 1000;
         timeout.tv_nsec = (timeout_ms % 1000) * 1000 * 1000;
     }
-    struct kevent active_evs[LOOFAH_MAX_ACTIVE_EVENTS];
+    _active_events.resize(_active_events_count);
+    struct kevent *const active_evs = _active_events.data();
 
     _poll_stage = PollStage::PollingWait;
-    const int n = ::kevent(_kq, nullptr, 0, active_evs, LOOFAH_MAX_ACTIVE_EVENTS, &timeout);
+    const int n = ::kevent(_kq, nullptr, 0, active_evs, (int) _active_events.size(), &timeout);
     _poll_stage = PollStage::HandlingEvents;
+    adapt_active_events_count(n);
     for (int i = 0; i < n; ++i)
     {
         // User event
@@ -915,31 +1142,20 @@ int Proactor::poll(int timeout_ms) noexcept
                 if (0 == handler->_request_accept)
                     disable_handler(handler, ProactHandler::ACCEPT_MASK);
 
-                while (true)
+                // NOTE 超出接收连接数时让出, 剩余的连接在下一轮 poll() 中
+                //      再次触发可读事件
+                for (size_t accepted = 0; 0 == _accept_budget || accepted < _accept_budget; ++accepted)
                 {
-                    const socket_t accepted = ReactAcceptorBase::accept(fd);
-                    if (LOOFAH_INVALID_SOCKET_FD == accepted)
+                    const socket_t accepted_fd = ReactAcceptorBase::accept(fd);
+                    if (LOOFAH_INVALID_SOCKET_FD == accepted_fd)
                         break;
-                    handler->handle_accept_completed(accepted);
+                    ++completed;
+                    handler->handle_accept_completed(accepted_fd);
                 }
             }
             else
             {
-                assert(!handler->_read_queue.empty());
-                IORequest *io_request = handler->_read_queue.front();
-                assert(nullptr != io_request);
-                handler->_read_queue.pop();
-
-                if (handler->_read_queue.empty())
-                    disable_handler(handler, ProactHandler::READ_MASK);
-
-                const ssize_t readed = ::readv(fd, io_request->iovs, io_request->buf_count);
-                if (readed >= 0)
-                    handler->handle_read_completed((size_t) readed);
-                else
-                    handler->handle_io_error(from_errno(errno));
-
-                IORequest::delete_request(io_request);
+                completed += complete_read_requests(handler);
             }
         }
         else if (EVFILT_WRITE == filter)
@@ -948,6 +1164,7 @@ int Proactor::poll(int timeout_ms) noexcept
             {
                 const int errcode = SockOperation::get_last_error(fd);
                 disable_handler(handler, ProactHandler::CONNECT_MASK);
+                ++completed;
                 if (0 == errcode)
                     handler->handle_connect_completed();
                 else
@@ -955,21 +1172,7 @@ int Proactor::poll(int timeout_ms) noexcept
             }
             else
             {
-                assert(!handler->_write_queue.empty());
-                IORequest *io_request = handler->_write_queue.front();
-                assert(nullptr != io_request);
-                handler->_write_queue.pop();
-
-                if (handler->_write_queue.empty())
-                    disable_handler(handler, ProactHandler::WRITE_MASK);
-
-                const ssize_t wrote = ::writev(fd, io_request->iovs, io_request->buf_count);
-                if (wrote >= 0)
-                    handler->handle_write_completed((size_t) wrote);
-                else
-                    handler->handle_io_error(from_errno(errno));
-
-                IORequest::delete_request(io_request);
+                completed += complete_write_requests(handler);
             }
         }
         else
@@ -979,11 +1182,20 @@ int Proactor::poll(int timeout_ms) noexcept
         }
     }
 #elif NUT_PLATFORM_OS_LINUX
+#   if LOOFAH_USE_IO_URING
+    if (_io_uring.is_valid())
+        return poll_io_uring(timeout_ms);
+#   endif
+
+    apply_epoll_changes();
+
     const int timeout = (timeout_ms < 0 ? -1 : timeout_ms);
-    struct epoll_event events[LOOFAH_MAX_ACTIVE_EVENTS];
+    _active_events.resize(_active_events_count);
+    struct epoll_event *const events = _active_events.data();
     _poll_stage = PollStage::PollingWait;
-    const int n = ::epoll_wait(_epoll_fd, events, LOOFAH_MAX_ACTIVE_EVENTS, timeout);
+    const int n = ::epoll_wait(_epoll_fd, events, (int) _active_events.size(), timeout);
     _poll_stage = PollStage::HandlingEvents;
+    adapt_active_events_count(n);
     for (int i = 0; i < n; ++i)
     {
         // 'eventfd' events
@@ -1025,31 +1237,20 @@ int Proactor::poll(int timeout_ms) noexcept
                 if (0 == handler->_request_accept)
                     disable_handler(handler, ProactHandler::ACCEPT_MASK);
 
-                while (true)
+                // NOTE 超出接收连接数时让出, 剩余的连接在下一轮 poll() 中
+                //      再次触发可读事件
+                for (size_t accepted = 0; 0 == _accept_budget || accepted < _accept_budget; ++accepted)
                 {
-                    const socket_t accepted = ReactAcceptorBase::accept(fd);
-                    if (LOOFAH_INVALID_SOCKET_FD == accepted)
+                    const socket_t accepted_fd = ReactAcceptorBase::accept(fd);
+                    if (LOOFAH_INVALID_SOCKET_FD == accepted_fd)
                         break;
-                    handler->handle_accept_completed(accepted);
+                    ++completed;
+                    handler->handle_accept_completed(accepted_fd);
                 }
             }
             else
             {
-                assert(!handler->_read_queue.empty());
-                IORequest *io_request = handler->_read_queue.front();
-                assert(nullptr != io_request);
-                handler->_read_queue.pop();
-
-                if (handler->_read_queue.empty())
-                    disable_handler(handler, ProactHandler::READ_MASK);
-
-                const ssize_t readed = ::readv(fd, io_request->iovs, io_request->buf_count);
-                if (readed >= 0)
-                    handler->handle_read_completed((size_t) readed);
-                else
-                    handler->handle_io_error(from_errno(errno));
-
-                IORequest::delete_request(io_request);
+                completed += complete_read_requests(handler);
             }
         }
         if (0 != (events[i].events & EPOLLOUT))
@@ -1058,6 +1259,7 @@ int Proactor::poll(int timeout_ms) noexcept
             {
                 const int errcode = SockOperation::get_last_error(fd);
                 disable_handler(handler, ProactHandler::CONNECT_MASK);
+                ++completed;
                 if (0 == errcode)
                     handler->handle_connect_completed();
                 else
@@ -1065,33 +1267,233 @@ int Proactor::poll(int timeout_ms) noexcept
             }
             else
             {
-                assert(!handler->_write_queue.empty());
-                IORequest *io_request = handler->_write_queue.front();
-                assert(nullptr != io_request);
-                handler->_write_queue.pop();
+                completed += complete_write_requests(handler);
+            }
+        }
+    }
+#endif
 
-                if (handler->_write_queue.empty())
-                    disable_handler(handler, ProactHandler::WRITE_MASK);
+    // Run asynchronized tasks
+    _poll_stage = PollStage::NotPolling;
+    run_later_tasks();
 
-                const ssize_t wrote = ::writev(fd, io_request->iovs, io_request->buf_count);
-                if (wrote >= 0)
-                    handler->handle_write_completed((size_t) wrote);
-                else
-                    handler->handle_io_error(from_errno(errno));
+    // Run timers
+    run_timers();
+
+    return completed;
+}
+
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+void Proactor::arm_io_uring_wakeup() noexcept
+{
+    assert(_io_uring.is_valid() && _event_fd >= 0);
+
+    struct io_uring_sqe *sqe = _io_uring.get_sqe();
+    if (nullptr == sqe)
+        return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = _event_fd;
+    sqe->poll_events = POLLIN;
+    sqe->user_data = IO_URING_WAKEUP_USER_DATA;
+}
+
+void Proactor::launch_io_uring_request(IORequest *io_request) noexcept
+{
+    assert(nullptr != io_request && nullptr != io_request->handler);
+    assert(_io_uring.is_valid());
+
+    ProactHandler *handler = io_request->handler;
+    struct io_uring_sqe *sqe = _io_uring.get_sqe();
+    if (nullptr == sqe)
+    {
+        _io_request_pool.release(io_request);
+        handler->handle_io_error(LOOFAH_ERR_UNKNOWN);
+        return;
+    }
+
+    sqe->fd = handler->get_socket();
+    sqe->user_data = (uint64_t) (uintptr_t) io_request;
+    switch (io_request->event_type)
+    {
+    case ProactHandler::ACCEPT_MASK:
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        handler->_read_queue.push(io_request);
+        break;
+
+    case ProactHandler::CONNECT_MASK:
+        // 非阻塞 connect() 已经发起, 等待可写即可
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll_events = POLLOUT;
+        handler->_write_queue.push(io_request);
+        break;
+
+    case ProactHandler::READ_MASK:
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = (uint64_t) (uintptr_t) io_request->iovs;
+        sqe->len = io_request->buf_count;
+        handler->_read_queue.push(io_request);
+        break;
+
+    case ProactHandler::WRITE_MASK:
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->addr = (uint64_t) (uintptr_t) io_request->iovs;
+        sqe->len = io_request->buf_count;
+        handler->_write_queue.push(io_request);
+        break;
+
+    default:
+        assert(false);
+    }
+}
+
+void Proactor::cancel_io_uring_requests(IORequestQueue *queue) noexcept
+{
+    assert(nullptr != queue && _io_uring.is_valid());
+
+    while (!queue->empty())
+    {
+        IORequest *io_request = queue->front();
+        assert(nullptr != io_request);
+        queue->pop();
+
+        // 孤立该请求, 其完成事件到达时释放
+        // NOTE 内核可能仍在读写请求的缓冲区, 在此之前不能释放 handler
+        io_request->orphan_owner = io_request->handler;
+        io_request->handler = nullptr;
+        _orphan_requests.insert(io_request);
+
+        // NOTE 取消失败时请求仍会正常完成, 或者在 shutdown() 中释放
+        struct io_uring_sqe *sqe = _io_uring.get_sqe();
+        if (nullptr == sqe)
+        {
+            NUT_LOG_W(TAG, "failed to cancel io_uring request, submission queue unavailable");
+            continue;
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = (uint64_t) (uintptr_t) io_request;
+        sqe->user_data = IO_URING_CANCEL_USER_DATA;
+    }
+}
+
+int Proactor::poll_io_uring(int timeout_ms) noexcept
+{
+    assert(_io_uring.is_valid());
 
-                IORequest::delete_request(io_request);
+    _poll_stage = PollStage::PollingWait;
+    const int rs = _io_uring.submit_and_wait(timeout_ms);
+    _poll_stage = PollStage::HandlingEvents;
+    if (rs < 0)
+    {
+        NUT_LOG_E(TAG, "failed to wait io_uring, errno %d: %s", -rs, ::strerror(-rs));
+        _poll_stage = PollStage::NotPolling;
+        return -1;
+    }
+
+    int completed = 0;
+    uint64_t user_data = 0;
+    int32_t res = 0;
+    while (_io_uring.pop_cqe(&user_data, &res))
+    {
+        // 'eventfd' events
+        if (IO_URING_WAKEUP_USER_DATA == user_data)
+        {
+            if (res < 0)
+            {
+                NUT_LOG_W(TAG, "eventfd error, fd %d", _event_fd);
+            }
+            else
+            {
+                uint64_t counter = 0;
+                const int n = ::read(_event_fd, &counter, sizeof(counter));
+                if (n < 0 && EAGAIN != errno)
+                    LOOFAH_LOG_FD_ERRNO(read, _event_fd);
             }
+            arm_io_uring_wakeup();
+            continue;
+        }
+        else if (IO_URING_CANCEL_USER_DATA == user_data)
+        {
+            continue;
+        }
+
+        // Socket events
+        IORequest *io_request = (IORequest*) user_data;
+        ProactHandler *handler = io_request->handler;
+        const ProactHandler::mask_type event_type = io_request->event_type;
+        if (nullptr == handler)
+        {
+            // handler 已经注销
+            release_orphan_request(io_request);
+            continue;
+        }
+        if (0 != (event_type & ProactHandler::ACCEPT_READ_MASK))
+            handler->_read_queue.remove(io_request); // NOTE 可能乱序完成
+        else
+            handler->_write_queue.remove(io_request);
+        _io_request_pool.release(io_request);
+        ++completed;
+
+        if (res < 0)
+        {
+            handler->handle_io_error(from_errno(-res));
+            continue;
+        }
+
+        switch (event_type)
+        {
+        case ProactHandler::ACCEPT_MASK:
+            handler->handle_accept_completed((socket_t) res);
+            break;
+
+        case ProactHandler::CONNECT_MASK:
+        {
+            const int errcode = SockOperation::get_last_error(handler->get_socket());
+            if (0 == errcode)
+                handler->handle_connect_completed();
+            else
+                handler->handle_io_error(from_errno(errcode));
+            break;
+        }
+
+        case ProactHandler::READ_MASK:
+            handler->handle_read_completed((size_t) res);
+            break;
+
+        case ProactHandler::WRITE_MASK:
+            handler->handle_write_completed((size_t) res);
+            break;
+
+        default:
+            assert(false);
         }
     }
-#endif
 
-    // Run asynchronized tasks
+    // NOTE 孤立请求所持有的 handler 可能随之析构, 需要放到轮询间隔中
     _poll_stage = PollStage::NotPolling;
+    _released_orphan_owners.clear();
+
+    // Run asynchronized tasks
     run_later_tasks();
 
-    return 0;
+    // Run timers
+    run_timers();
+
+    return completed;
 }
 
+void Proactor::release_orphan_request(IORequest *io_request) noexcept
+{
+    assert(nullptr != io_request && nullptr == io_request->handler);
+
+    _orphan_requests.erase(io_request);
+    if (nullptr != io_request->orphan_owner)
+        _released_orphan_owners.push_back(std::move(io_request->orphan_owner));
+    _io_request_pool.release(io_request);
+}
+#endif
+
 void Proactor::wakeup_poll_wait() noexcept
 {
 #if NUT_PLATFORM_OS_WINDOWS
@@ -5,11 +5,21 @@
 #include "../loofah_config.h"
 
 #include <unordered_set>
+#include <vector>
 #include <atomic>
 
 #include <nut/platform/platform.h>
 
+#if NUT_PLATFORM_OS_MACOS
+#   include <sys/types.h>
+#   include <sys/event.h> // for struct kevent
+#elif NUT_PLATFORM_OS_LINUX
+#   include <sys/epoll.h> // for struct epoll_event
+#endif
+
 #include "proact_handler.h"
+#include "io_request.h"
+#include "io_uring.h"
 #include "../inet_base/poller_base.h"
 #include "../inet_base/inet_addr.h"
 
@@ -56,21 +66,56 @@ public:
     void shutdown_later() noexcept;
 
     /**
+     * NOTE 最多等待到最近的定时器到期, 参见 PollerBase::add_timer()
+     *
      * @param timeout_ms <0 表示无限等待; >=0 等待超时的毫秒数
-     * @return 0 表示正常; <0 表示出错
+     * @return >=0 表示本轮完成的请求数(包括接收的连接); <0 表示出错
      */
     int poll(int timeout_ms = 1000) noexcept;
 
     virtual void wakeup_poll_wait() noexcept final override;
 
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+    /**
+     * 是否使用 io_uring 实现, 否则为 epoll 模拟实现
+     */
+    bool is_io_uring_enabled() const noexcept;
+#endif
+
 protected:
 #if NUT_PLATFORM_OS_MACOS || NUT_PLATFORM_OS_LINUX
     void enable_handler(ProactHandler *handler, ProactHandler::mask_type mask) noexcept;
     void disable_handler(ProactHandler *handler, ProactHandler::mask_type mask) noexcept;
+
+    /**
+     * 就绪后连续完成队列中的读/写请求, 直到 socket 读空/写满或者达到
+     * LOOFAH_MAX_COMPLETIONS_PER_EVENT
+     *
+     * @return 完成的请求数
+     */
+    size_t complete_read_requests(ProactHandler *handler) noexcept;
+    size_t complete_write_requests(ProactHandler *handler) noexcept;
+#endif
+
+#if NUT_PLATFORM_OS_LINUX
+    /**
+     * 将 enable_handler() / disable_handler() 积累的变化同步到 epoll 中
+     */
+    void apply_epoll_changes() noexcept;
 #endif
 
     void shutdown() noexcept;
 
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+    void arm_io_uring_wakeup() noexcept;
+    void launch_io_uring_request(IORequest *io_request) noexcept;
+    void cancel_io_uring_requests(IORequestQueue *queue) noexcept;
+    int poll_io_uring(int timeout_ms) noexcept;
+
+    // 释放已完成的孤立请求, 所持有的 handler 留到轮询间隔中再释放
+    void release_orphan_request(IORequest *io_request) noexcept;
+#endif
+
 private:
 #if NUT_PLATFORM_OS_WINDOWS
     // NOTE 函数 ::CreateIoCompletionPort() 将 nullptr 作为失败返回值, 而不是
@@ -79,8 +124,24 @@ private:
     std::unordered_set<socket_t> _associated_sockets;
 #elif NUT_PLATFORM_OS_MACOS
     int _kq = -1;
+    std::vector<struct kevent> _active_events;
 #elif NUT_PLATFORM_OS_LINUX
     int _epoll_fd = -1;
+    std::vector<struct epoll_event> _active_events;
+
+    // NOTE 在 poll() 等待前统一调用 epoll_ctl(), 这样一次轮询中先关闭又重新开启
+    //      的事件(例如一问一答中连续发起的读请求)不需要任何系统调用
+    std::vector<nut::rc_ptr<ProactHandler>> _dirty_handlers, _applying_handlers;
+#   if LOOFAH_USE_IO_URING
+    // 内核支持时使用 io_uring 实现, 否则使用 epoll 模拟
+    IOUring _io_uring;
+
+    // 已注销的 handler 尚未完成的请求, 等待其完成事件后释放
+    std::unordered_set<IORequest*> _orphan_requests;
+
+    // 本轮已完成的孤立请求所持有的 handler
+    std::vector<nut::rc_ptr<ProactHandler>> _released_orphan_owners;
+#   endif
 #endif
 
 #if NUT_PLATFORM_OS_LINUX
@@ -88,6 +149,9 @@ private:
     int _event_fd = -1;
 #endif
 
+    // 复用已完成的 IORequest
+    IORequestPool _io_request_pool;
+
     std::atomic<bool> _closing_or_closed = ATOMIC_VAR_INIT(false);
 };
 
@@ -9,6 +9,8 @@
 #include "../inet_base/utils.h"
 #include "../inet_base/sock_operation.h"
 #include "../inet_base/error.h"
+#include "../inet_base/event_loop_group.h"
+#include "reactor.h"
 #include "react_acceptor.h"
 #include "react_channel.h"
 
@@ -69,6 +71,11 @@ bool ReactAcceptorBase::listen(const InetAddr& addr, int listen_num) noexcept
     return true;
 }
 
+void ReactAcceptorBase::set_loop_group(EventLoopGroupBase *loop_group) noexcept
+{
+    _loop_group = loop_group;
+}
+
 socket_t ReactAcceptorBase::get_socket() const noexcept
 {
     return _listening_socket;
@@ -76,19 +83,45 @@ socket_t ReactAcceptorBase::get_socket() const noexcept
 
 void ReactAcceptorBase::handle_accept_ready() noexcept
 {
-    // NOTE 在 edge-trigger 模式下，需要一次接收干净
-    while (true)
+    assert(nullptr != _registered_reactor);
+
+    // NOTE 在 edge-trigger 模式下，需要一次接收干净; 超出接收连接数时交给
+    //      Reactor::defer_read_ready() 在下一轮继续接收
+    const size_t budget = _registered_reactor->get_accept_budget();
+    for (size_t accepted = 0; true; ++accepted)
     {
         // Accept
         const socket_t fd = accept(_listening_socket);
         if (LOOFAH_INVALID_SOCKET_FD == fd)
             break;
 
+        // 达到接收连接数上限后仍能接收到, 说明还有排队的连接, 处理完这个后
+        // 让出给已建立的连接; 没有排队的连接则不必推迟
+        const bool exhausted = (0 != budget && accepted >= budget);
+
         // Create new handler
         nut::rc_ptr<ReactChannel> channel = create_channel();
-        channel->initialize();
-        channel->open(fd);
-        channel->handle_channel_connected();
+        if (nullptr != _loop_group)
+        {
+            // 分派到其他事件循环中
+            _loop_group->dispatch([=] (PollerBase*) {
+                channel->initialize();
+                channel->open(fd);
+                channel->handle_channel_connected();
+            });
+        }
+        else
+        {
+            channel->initialize();
+            channel->open(fd);
+            channel->handle_channel_connected();
+        }
+
+        if (exhausted)
+        {
+            _registered_reactor->defer_read_ready(this);
+            break;
+        }
     }
 }
 
@@ -99,7 +132,13 @@ socket_t ReactAcceptorBase::accept(socket_t listening_socket) noexcept
     socket_t fd = LOOFAH_INVALID_SOCKET_FD;
     while (true)
     {
+#if NUT_PLATFORM_OS_LINUX
+        // 一次系统调用同时设置非阻塞和 close-on-exec
+        fd = ::accept4(listening_socket, peer_addr.cast_to_sockaddr(), &rsz,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
         fd = ::accept(listening_socket, peer_addr.cast_to_sockaddr(), &rsz);
+#endif
         if (LOOFAH_INVALID_SOCKET_FD != fd)
             break;
 
@@ -125,8 +164,14 @@ socket_t ReactAcceptorBase::accept(socket_t listening_socket) noexcept
 #endif
     }
 
+#if !NUT_PLATFORM_OS_LINUX
     if (!SockOperation::set_nonblocking(fd))
         NUT_LOG_W(TAG, "failed to make socket nonblocking, socketfd %d", fd);
+#endif
+#if NUT_PLATFORM_OS_MACOS
+    if (!SockOperation::set_close_on_exit(fd))
+        NUT_LOG_W(TAG, "failed to make socket close-on-exec, socketfd %d", fd);
+#endif
 
     return fd;
 }
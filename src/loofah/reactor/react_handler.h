@@ -81,6 +81,9 @@ private:
     // ACCEPT_MASK, CONNECT_MASK, READ_MASK, WRITE_MASK
     mask_type _enabled_events = 0;
 
+    // 是否在等待下一轮 poll() 继续读, 参见 Reactor::defer_read_ready()
+    bool _read_deferred = false;
+
     // 用于记录注册状态，参见 Reactor 的实现
 #if NUT_PLATFORM_OS_WINDOWS && WINVER >= _WIN32_WINNT_WINBLUE
     bool _registered = false;
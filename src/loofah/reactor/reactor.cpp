@@ -234,6 +234,10 @@ void Reactor::shutdown() noexcept
     }
     _epoll_fd = -1;
 #endif
+
+    for (size_t i = 0, sz = _deferred_handlers.size(); i < sz; ++i)
+        _deferred_handlers.at(i)->_read_deferred = false;
+    _deferred_handlers.clear();
 }
 
 #if NUT_PLATFORM_OS_WINDOWS && WINVER >= _WIN32_WINNT_WINBLUE
@@ -303,6 +307,7 @@ void Reactor::register_handler(ReactHandler *handler, ReactHandler::mask_type ma
 #endif
 
     handler->_registered_reactor = this;
+    _handler_count.fetch_add(1, std::memory_order_relaxed);
 
     enable_handler(handler, mask);
 }
@@ -329,6 +334,8 @@ void Reactor::unregister_handler(ReactHandler *handler) noexcept
     assert(nullptr != handler && handler->_registered_reactor == this);
     assert(is_in_io_thread());
 
+    _handler_count.fetch_sub(1, std::memory_order_relaxed);
+
     const socket_t fd = handler->get_socket();
 
 #if NUT_PLATFORM_OS_WINDOWS && WINVER < _WIN32_WINNT_WINBLUE
@@ -469,14 +476,16 @@ void Reactor::enable_handler(ReactHandler *handler, ReactHandler::mask_type mask
         if (0 != (handler->_registered_events & ReactHandler::READ_MASK))
             EV_SET(ev + n++, fd, EVFILT_READ, EV_ENABLE, 0, 0, (void*) handler);
         else
-            EV_SET(ev + n++, fd, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, (void*) handler);
+            EV_SET(ev + n++, fd, EVFILT_READ, EV_ADD | EV_ENABLE | (_edge_triggered ? EV_CLEAR : 0),
+                   0, 0, (void*) handler);
     }
     if (0 != (need_enable & ReactHandler::WRITE_MASK))
     {
         if (0 != (handler->_registered_events & ReactHandler::WRITE_MASK))
             EV_SET(ev + n++, fd, EVFILT_WRITE, EV_ENABLE, 0, 0, (void*) handler);
         else
-            EV_SET(ev + n++, fd, EVFILT_WRITE, EV_ADD | EV_ENABLE, 0, 0, (void*) handler);
+            EV_SET(ev + n++, fd, EVFILT_WRITE, EV_ADD | EV_ENABLE | (_edge_triggered ? EV_CLEAR : 0),
+                   0, 0, (void*) handler);
     }
     if (n > 0 && 0 != ::kevent(_kq, ev, n, nullptr, 0, nullptr))
     {
@@ -512,6 +521,24 @@ void Reactor::enable_handler(ReactHandler *handler, ReactHandler::mask_type mask
 #endif
 }
 
+void Reactor::set_edge_triggered(bool edge_triggered) noexcept
+{
+    assert(is_in_io_thread());
+    assert(0 == get_handler_count());
+
+#if NUT_PLATFORM_OS_WINDOWS
+    UNUSED(edge_triggered);
+    NUT_LOG_W(TAG, "edge-triggered mode is not supported on Windows");
+#else
+    _edge_triggered = edge_triggered;
+#endif
+}
+
+bool Reactor::is_edge_triggered() const noexcept
+{
+    return _edge_triggered;
+}
+
 void Reactor::disable_handler_later(ReactHandler *handler, ReactHandler::mask_type mask) noexcept
 {
     assert(nullptr != handler);
@@ -608,6 +635,11 @@ int Reactor::poll(int timeout_ms) noexcept
         return -1;
     }
 
+    // 等待时间不超过最近的定时器到期时间; 有让出的 handler 时不等待
+    timeout_ms = get_poll_timeout(timeout_ms);
+    if (!_deferred_handlers.empty())
+        timeout_ms = 0;
+
 #if NUT_PLATFORM_OS_WINDOWS && WINVER < _WIN32_WINNT_WINBLUE
     struct timeval timeout;
     if (timeout_ms < 0)
@@ -790,11 +822,13 @@ int Reactor::poll(int timeout_ms) noexcept
         timeout.tv_sec = timeout_ms / 1000;
         timeout.tv_nsec = (timeout_ms % 1000) * 1000 * 1000;
     }
-    struct kevent active_evs[LOOFAH_MAX_ACTIVE_EVENTS];
+    _active_events.resize(_active_events_count);
+    struct kevent *const active_evs = _active_events.data();
 
     _poll_stage = PollStage::PollingWait;
-    const int n = ::kevent(_kq, nullptr, 0, active_evs, LOOFAH_MAX_ACTIVE_EVENTS, &timeout);
+    const int n = ::kevent(_kq, nullptr, 0, active_evs, (int) _active_events.size(), &timeout);
     _poll_stage = PollStage::HandlingEvents;
+    adapt_active_events_count(n);
     for (int i = 0; i < n; ++i)
     {
         // User event
@@ -832,12 +866,15 @@ int Reactor::poll(int timeout_ms) noexcept
     }
 #elif NUT_PLATFORM_OS_LINUX
     const int timeout = (timeout_ms < 0 ? -1 : timeout_ms);
-    struct epoll_event events[LOOFAH_MAX_ACTIVE_EVENTS];
+    _active_events.resize(_active_events_count);
+    struct epoll_event *const events = _active_events.data();
     _poll_stage = PollStage::PollingWait;
-    const int n = ::epoll_wait(_epoll_fd, events, LOOFAH_MAX_ACTIVE_EVENTS, timeout);
+    const int n = ::epoll_wait(_epoll_fd, events, (int) _active_events.size(), timeout);
     _poll_stage = PollStage::HandlingEvents;
-    if (n < 0)
+    adapt_active_events_count(n);
+    if (n < 0 && EINTR != errno)
     {
+        // NOTE 被信号或者 io_uring 的 task_work 打断时返回 EINTR, 不算出错
         LOOFAH_LOG_ERRNO(epoll_wait);
         return -1;
     }
@@ -890,13 +927,78 @@ int Reactor::poll(int timeout_ms) noexcept
     }
 #endif
 
+    // 继续处理上一轮让出的 handler
+    handle_deferred_reads();
+
     // Run asynchronized tasks
+    // NOTE 释放 handler 引用可能导致 channel 析构, 需要放到轮询间隔
     _poll_stage = PollStage::NotPolling;
+    _handling_deferred_handlers.clear();
     run_later_tasks();
 
+    // Run timers
+    run_timers();
+
     return 0;
 }
 
+void Reactor::set_read_quota(size_t max_bytes) noexcept
+{
+    _read_quota = max_bytes;
+}
+
+size_t Reactor::get_read_quota() const noexcept
+{
+    return _read_quota;
+}
+
+void Reactor::defer_read_ready(ReactHandler *handler) noexcept
+{
+    assert(nullptr != handler && handler->_registered_reactor == this);
+    assert(is_in_io_thread());
+
+    // NOTE level-triggered 模式下, 尚有未读数据时下一轮 poll() 会再次报告可读
+    //      事件; 如果在此记录, 同一轮中会被处理两次, 超出读取配额
+    if (!_edge_triggered || handler->_read_deferred)
+        return;
+    handler->_read_deferred = true;
+    _deferred_handlers.emplace_back(handler);
+}
+
+void Reactor::handle_deferred_reads() noexcept
+{
+    if (_deferred_handlers.empty())
+        return;
+
+    // NOTE 处理过程中再次让出的 handler 留到下一轮
+    assert(_handling_deferred_handlers.empty());
+    _handling_deferred_handlers.swap(_deferred_handlers);
+    for (size_t i = 0, sz = _handling_deferred_handlers.size(); i < sz; ++i)
+    {
+        ReactHandler *handler = _handling_deferred_handlers.at(i);
+        handler->_read_deferred = false;
+
+        // 期间可能已经注销, 或者关闭了读
+        if (handler->_registered_reactor != this)
+            continue;
+        if (0 != (handler->_enabled_events & ReactHandler::ACCEPT_MASK))
+            handler->handle_accept_ready();
+        else if (0 != (handler->_enabled_events & ReactHandler::READ_MASK))
+            handler->handle_read_ready();
+    }
+}
+
+void* Reactor::get_shared_read_buffer(size_t *buf_size) noexcept
+{
+    assert(nullptr != buf_size);
+    assert(is_in_io_thread());
+
+    if (_shared_read_buffer.empty())
+        _shared_read_buffer.resize(LOOFAH_SHARED_READ_BUFFER_SIZE);
+    *buf_size = _shared_read_buffer.size();
+    return _shared_read_buffer.data();
+}
+
 void Reactor::wakeup_poll_wait() noexcept
 {
 #if NUT_PLATFORM_OS_WINDOWS
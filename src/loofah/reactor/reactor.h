@@ -5,9 +5,18 @@
 #include "../loofah_config.h"
 
 #include <unordered_map>
+#include <vector>
 #include <atomic>
 
 #include <nut/platform/platform.h>
+#include <nut/rc/rc_ptr.h>
+
+#if NUT_PLATFORM_OS_MACOS
+#   include <sys/types.h>
+#   include <sys/event.h> // for struct kevent
+#elif NUT_PLATFORM_OS_LINUX
+#   include <sys/epoll.h> // for struct epoll_event
+#endif
 
 #include "../inet_base/poller_base.h"
 #include "react_handler.h"
@@ -34,12 +43,57 @@ public:
     void disable_handler(ReactHandler *handler, ReactHandler::mask_type mask) noexcept;
     void disable_handler_later(ReactHandler *handler, ReactHandler::mask_type mask) noexcept;
 
+    /**
+     * 设置为 edge-triggered 模式(epoll 的 EPOLLET, kqueue 的 EV_CLEAR)
+     *
+     * edge-triggered 模式下, 事件只在状态变化时通知一次, 所有 handler 都需要在
+     * 事件处理中一直读/写到 LOOFAH_ERR_WOULD_BLOCK; 相应地, 可以一直开启
+     * WRITE_MASK 而不必反复开关, 从而省去 epoll_ctl() 调用
+     *
+     * NOTE
+     * - ReactAcceptor, ReactPackageChannel 均支持 edge-triggered 模式
+     * - 只能在注册任何 handler 之前设置
+     * - Windows 下不支持, 设置无效
+     */
+    void set_edge_triggered(bool edge_triggered) noexcept;
+    bool is_edge_triggered() const noexcept;
+
+    /**
+     * 设置每个 handler 单轮 poll() 最多读取的字节数, 超出后 handler 应该调用
+     * defer_read_ready() 让出, 避免单个繁忙连接独占 IO 线程
+     *
+     * NOTE 0 表示不限制; 由 handler 自行遵守, ReactPackageChannel 未单独设置
+     *      时使用该值
+     */
+    void set_read_quota(size_t max_bytes) noexcept;
+    size_t get_read_quota() const noexcept;
+
+    /**
+     * handler 尚有未读完的数据, 下一轮 poll() 不等待事件就再次调用其
+     * handle_read_ready() / handle_accept_ready()
+     *
+     * NOTE
+     * - 只能在 IO 线程中调用; 同一轮中多次调用只触发一次
+     * - 只在 edge-triggered 模式下生效, level-triggered 模式下可读事件会在下
+     *   一轮 poll() 中再次报告
+     */
+    void defer_read_ready(ReactHandler *handler) noexcept;
+
+    /**
+     * reactor 内所有 handler 共享的临时读缓冲, 大小为 LOOFAH_SHARED_READ_BUFFER_SIZE
+     *
+     * NOTE 只能在 IO 线程中使用, 且在事件处理返回前必须将数据拷贝走
+     */
+    void* get_shared_read_buffer(size_t *buf_size) noexcept;
+
     /**
      * 关闭 reactor
      */
     void shutdown_later() noexcept;
 
     /**
+     * NOTE 最多等待到最近的定时器到期, 参见 PollerBase::add_timer()
+     *
      * @param timeout_ms <0 无限等待; >=0 等待超时的毫秒数
      * @return 0 表示正常; <0 表示出错
      */
@@ -55,6 +109,10 @@ protected:
 
     void shutdown() noexcept;
 
+private:
+    // 处理上一轮让出的 handler
+    void handle_deferred_reads() noexcept;
+
 private:
 #if NUT_PLATFORM_OS_WINDOWS && WINVER < _WIN32_WINNT_WINBLUE
     // Windows 8.1 之前，使用 ::select() 实现
@@ -71,12 +129,23 @@ private:
 #elif NUT_PLATFORM_OS_MACOS
     // 使用 ::kqueue() 实现
     int _kq = -1;
+    std::vector<struct kevent> _active_events;
 #elif NUT_PLATFORM_OS_LINUX
     // 使用 ::epoll() 实现
     int _epoll_fd = -1;
-    bool _edge_triggered = false; // level-triggered or edge-triggered
+    std::vector<struct epoll_event> _active_events;
 #endif
 
+    // level-triggered or edge-triggered
+    bool _edge_triggered = false;
+
+    // 每个 handler 单轮最多读取的字节数, 以及让出到下一轮的 handler
+    size_t _read_quota = LOOFAH_DEFAULT_READ_QUOTA;
+    std::vector<nut::rc_ptr<ReactHandler>> _deferred_handlers, _handling_deferred_handlers;
+
+    // 共享读缓冲, 首次使用时分配
+    std::vector<uint8_t> _shared_read_buffer;
+
 #if NUT_PLATFORM_OS_WINDOWS
     // socketpair
     socket_t _sockpair[2]; // event input, event output
@@ -0,0 +1,165 @@
+﻿
+#include <loofah/loofah.h>
+#include <nut/nut.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#if NUT_PLATFORM_OS_WINDOWS
+#   include <windows.h>
+#endif
+
+
+#define TAG "test_event_loop_group"
+#define LISTEN_ADDR "localhost"
+#define LISTEN_PORT 2351
+#define LOOP_COUNT 2
+#define CONNECTION_COUNT 4
+
+using namespace nut;
+using namespace loofah;
+
+namespace
+{
+
+class ServerChannel;
+
+Reactor *reactor = nullptr;
+EventLoopGroup<Reactor> *loop_group = nullptr;
+
+std::mutex lock;
+std::vector<rc_ptr<ServerChannel>> servers;
+std::multiset<Reactor*> used_loops;
+std::atomic<int> closed_count = ATOMIC_VAR_INIT(0);
+
+class ServerChannel : public ReactChannel
+{
+    Reactor *_reactor = nullptr;
+
+public:
+    virtual void initialize() noexcept override
+    {
+        // 运行在分派到的事件循环线程中
+        _reactor = loop_group->current_loop();
+        assert(nullptr != _reactor);
+
+        std::lock_guard<std::mutex> guard(lock);
+        servers.push_back(this);
+        used_loops.insert(_reactor);
+    }
+
+    virtual void handle_channel_connected() noexcept override
+    {
+        NUT_LOG_D(TAG, "server got a connection, fd %d", get_socket());
+        _reactor->register_handler(this, ReactHandler::READ_MASK);
+    }
+
+    virtual void handle_read_ready() noexcept override
+    {
+        int seq = 0;
+        const int rs = _sock_stream.read(&seq, sizeof(seq));
+        if (0 != rs)
+            return;
+
+        // 正常结束
+        NUT_LOG_D(TAG, "server will close");
+        _reactor->unregister_handler(this);
+        _sock_stream.close();
+        ++closed_count;
+
+        nut::rc_ptr<ServerChannel> ref_this(this);
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < servers.size(); ++i)
+        {
+            if (servers[i] == ref_this)
+            {
+                servers.erase(servers.begin() + i);
+                break;
+            }
+        }
+    }
+
+    virtual void handle_write_ready() noexcept override
+    {}
+
+    virtual void handle_io_error(int err) noexcept override
+    {
+        NUT_LOG_E(TAG, "server exception %d", err);
+    }
+};
+
+}
+
+class TestEventLoopGroup : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_round_robin);
+    }
+
+    virtual void set_up() override
+    {
+        reactor = new Reactor;
+        reactor->set_accept_budget(1); // 每次唤醒只接受一个连接, 覆盖延后处理的路径
+        loop_group = new EventLoopGroup<Reactor>;
+    }
+
+    virtual void tear_down() override
+    {
+        delete loop_group;
+        loop_group = nullptr;
+        delete reactor;
+        reactor = nullptr;
+    }
+
+    void test_round_robin()
+    {
+        NUT_TA(loop_group->start(LOOP_COUNT, false));
+        NUT_TA(LOOP_COUNT == loop_group->size());
+        NUT_TA(nullptr == loop_group->current_loop());
+
+        // Start server
+        InetAddr addr(LISTEN_ADDR, LISTEN_PORT);
+        rc_ptr<ReactAcceptor<ServerChannel>> acc = rc_new<ReactAcceptor<ServerChannel>>();
+        acc->listen(addr);
+        acc->set_loop_group(loop_group);
+        reactor->register_handler_later(acc, ReactHandler::ACCEPT_MASK);
+
+        // Clients
+        socket_t client_fds[CONNECTION_COUNT];
+        for (int i = 0; i < CONNECTION_COUNT; ++i)
+        {
+            client_fds[i] = ::socket(PF_INET, SOCK_STREAM, 0);
+            ::connect(client_fds[i], addr.cast_to_sockaddr(), addr.get_sockaddr_size());
+        }
+
+        // Loop
+        for (int i = 0; i < 100; ++i)
+        {
+            reactor->poll(10);
+            std::lock_guard<std::mutex> guard(lock);
+            if (CONNECTION_COUNT == used_loops.size())
+                break;
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            NUT_TA(CONNECTION_COUNT == used_loops.size());
+            for (size_t i = 0; i < LOOP_COUNT; ++i)
+                NUT_TA(CONNECTION_COUNT / LOOP_COUNT == used_loops.count(loop_group->get_loop(i)));
+        }
+
+        // Close clients
+        for (int i = 0; i < CONNECTION_COUNT; ++i)
+            SockOperation::close(client_fds[i]);
+        for (int i = 0; i < 100 && closed_count < CONNECTION_COUNT; ++i)
+            reactor->poll(10);
+        NUT_TA(CONNECTION_COUNT == closed_count);
+
+        reactor->unregister_handler(acc);
+        loop_group->stop();
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestEventLoopGroup, "react, all")
@@ -0,0 +1,55 @@
+﻿
+#include <loofah/loofah.h>
+#include <nut/nut.h>
+
+#include <string.h>
+
+
+using namespace nut;
+using namespace loofah;
+
+class TestPackage : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_slice);
+        NUT_REGISTER_CASE(test_copy_on_write);
+    }
+
+    void test_slice()
+    {
+        rc_ptr<Package> pkg = rc_new<Package>("abcdef", 6);
+        rc_ptr<Package> s = pkg->slice(2, 3);
+        NUT_TA(pkg->is_shared() && s->is_shared());
+        NUT_TA(3 == s->readable_size());
+        NUT_TA(0 == ::memcmp(s->readable_data(), "cde", 3));
+        NUT_TA(((const char*) pkg->readable_data()) + 2 == s->readable_data());
+
+        // 父包释放后切片仍然有效
+        pkg = nullptr;
+        NUT_TA(!s->is_shared());
+        NUT_TA(0 == ::memcmp(s->readable_data(), "cde", 3));
+    }
+
+    void test_copy_on_write()
+    {
+        rc_ptr<Package> pkg = rc_new<Package>("abcdef", 6);
+        rc_ptr<Package> s1 = pkg->slice(0, 3), s2 = pkg->slice(3, 3);
+
+        // 写入切片不能影响相邻的数据
+        s1->write("xy", 2);
+        NUT_TA(!s1->is_shared());
+        NUT_TA(5 == s1->readable_size());
+        NUT_TA(0 == ::memcmp(s1->readable_data(), "abcxy", 5));
+        NUT_TA(0 == ::memcmp(s2->readable_data(), "def", 3));
+        NUT_TA(0 == ::memcmp(pkg->readable_data(), "abcdef", 6));
+
+        // raw_pack() 写入的 header 位置属于 s1
+        s2->raw_pack();
+        NUT_TA(!s2->is_shared());
+        NUT_TA(0 == ::memcmp(pkg->readable_data(), "abcdef", 6));
+        NUT_TA(sizeof(Package::header_type) + 3 == s2->readable_size());
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestPackage, "package, all")
@@ -0,0 +1,56 @@
+﻿
+#include <loofah/loofah.h>
+#include <nut/nut.h>
+
+
+using namespace nut;
+using namespace loofah;
+
+class TestPackagePool : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_recycle);
+        NUT_REGISTER_CASE(test_oversize);
+    }
+
+    void test_recycle()
+    {
+        rc_ptr<PackagePool> pool = rc_new<PackagePool>();
+
+        rc_ptr<Package> pkg = pool->acquire(100);
+        NUT_TA(pkg->capacity() >= 100);
+        NUT_TA(0 == pool->get_hit_count() && 1 == pool->get_miss_count());
+        Package *raw = pkg;
+        *pkg << (int) 12;
+        pkg = nullptr;
+        NUT_TA(1 == pool->get_cached_count());
+
+        // 同一级别复用, 并且已被清空
+        pkg = pool->acquire(200);
+        NUT_TA(raw == pkg.pointer());
+        NUT_TA(0 == pkg->readable_size());
+        NUT_TA(1 == pool->get_hit_count() && 1 == pool->get_miss_count());
+        NUT_TA(0 == pool->get_cached_count());
+
+        // 不同级别不复用
+        rc_ptr<Package> pkg2 = pool->acquire(2000);
+        NUT_TA(1 == pool->get_hit_count() && 2 == pool->get_miss_count());
+
+        // 池先于 package 释放
+        pool = nullptr;
+        pkg = nullptr;
+        pkg2 = nullptr;
+    }
+
+    void test_oversize()
+    {
+        rc_ptr<PackagePool> pool = rc_new<PackagePool>();
+        rc_ptr<Package> pkg = pool->acquire(1024 * 1024);
+        NUT_TA(1 == pool->get_miss_count());
+        pkg = nullptr;
+        NUT_TA(0 == pool->get_cached_count());
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestPackagePool, "package, all")
@@ -2,10 +2,14 @@
 #include <loofah/loofah.h>
 #include <nut/nut.h>
 
+#include <stdio.h>
+#include <vector>
+
 
 #define TAG "test_proact_package"
 #define LISTEN_ADDR "localhost"
 #define LISTEN_PORT 2348
+#define FILE_LISTEN_PORT 2357
 
 using namespace nut;
 using namespace loofah;
@@ -23,6 +27,10 @@ rc_ptr<ServerChannel> server;
 rc_ptr<ClientChannel> client;
 bool prepared = false;
 
+rc_ptr<ProactPackageChannel> file_server, file_client;
+FILE *send_file_fp = nullptr;
+std::vector<rc_ptr<Package>> file_client_received;
+
 class ServerChannel : public ProactPackageChannel
 {
     int _counter = 0;
@@ -128,6 +136,67 @@ public:
     }
 };
 
+/**
+ * 连接后发送文件内容, 然后关闭
+ */
+class FileChannel : public ProactPackageChannel
+{
+    bool _is_server = false;
+
+public:
+    explicit FileChannel(bool is_server = true) noexcept
+        : _is_server(is_server)
+    {}
+
+    virtual void initialize() noexcept override
+    {
+        set_proactor(proactor);
+        if (_is_server)
+        {
+            file_server = this;
+            prepared = true;
+        }
+        else
+        {
+            file_client = this;
+        }
+    }
+
+    virtual void handle_connected() noexcept override
+    {
+        if (!_is_server)
+            return;
+
+        ::fseek(send_file_fp, 0, SEEK_END);
+        const long file_size = ::ftell(send_file_fp);
+        send_file(::fileno(send_file_fp), 0, file_size);
+        close();
+    }
+
+    virtual void handle_read(Package *pkg) noexcept override
+    {
+        file_client_received.push_back(pkg);
+    }
+
+    virtual void handle_closed(int err) noexcept override
+    {
+        NUT_LOG_D(TAG, "file %s closed, %d: %s", (_is_server ? "server" : "client"),
+                  err, str_error(err));
+        if (_is_server)
+            file_server = nullptr;
+        else
+            file_client = nullptr;
+    }
+};
+
+class FileClientChannel : public FileChannel
+{
+public:
+    FileClientChannel() noexcept
+        : FileChannel(false)
+    {}
+};
+
 }
 
 class TestProactPackageChannel : public TestFixture
@@ -135,11 +204,13 @@ class TestProactPackageChannel : public TestFixture
     virtual void register_cases() noexcept override
     {
         NUT_REGISTER_CASE(test_proact_package_channel);
+        NUT_REGISTER_CASE(test_send_file);
     }
 
     virtual void set_up() override
     {
         proactor = new Proactor;
+        prepared = false;
     }
 
     virtual void tear_down() override
@@ -171,6 +242,42 @@ class TestProactPackageChannel : public TestFixture
             timewheel.tick();
         }
     }
+
+    void test_send_file()
+    {
+        // 超过 LOOFAH_MAX_WRITE_BYTES, 需要分多次读入
+        send_file_fp = ::tmpfile();
+        NUT_TA(nullptr != send_file_fp);
+        std::vector<uint8_t> content(LOOFAH_MAX_WRITE_BYTES + 1000);
+        for (size_t i = 0, sz = content.size(); i < sz; ++i)
+            content[i] = (uint8_t) (i * 7);
+        NUT_TA(content.size() == ::fwrite(content.data(), 1, content.size(), send_file_fp));
+        ::fflush(send_file_fp);
+
+        InetAddr addr(LISTEN_ADDR, FILE_LISTEN_PORT);
+        rc_ptr<ProactAcceptor<FileChannel>> acc = rc_new<ProactAcceptor<FileChannel>>();
+        acc->listen(addr);
+        proactor->register_handler_later(acc);
+        proactor->launch_accept_later(acc);
+
+        ProactConnector<FileClientChannel> con;
+        con.connect(proactor, addr);
+
+        file_client_received.clear();
+        while (!prepared || file_server != nullptr || file_client != nullptr)
+        {
+            if (proactor->poll(-1) < 0)
+                break;
+        }
+        ::fclose(send_file_fp);
+        send_file_fp = nullptr;
+
+        NUT_TA(1 == file_client_received.size());
+        Package *file_pkg = file_client_received.at(0);
+        NUT_TA(file_pkg->readable_size() == content.size());
+        NUT_TA(0 == ::memcmp(file_pkg->readable_data(), content.data(), content.size()));
+        file_client_received.clear();
+    }
 };
 
 NUT_REGISTER_FIXTURE(TestProactPackageChannel, "proact, package, all")
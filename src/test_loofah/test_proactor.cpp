@@ -4,6 +4,7 @@
 
 #if !NUT_PLATFORM_OS_WINDOWS
 #   include <unistd.h>
+#   include <sys/socket.h> // for ::socketpair()
 #endif
 
 
@@ -156,6 +157,122 @@ public:
     }
 };
 
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+/**
+ * 注销时仍有读请求未完成的 handler
+ */
+class OrphanHandler : public ProactHandler
+{
+public:
+    static int alive_count;
+
+    char buf[64];
+
+public:
+    explicit OrphanHandler(socket_t fd) noexcept
+        : _fd(fd)
+    {
+        ::memset(buf, 0, sizeof(buf));
+        ++alive_count;
+    }
+
+    virtual ~OrphanHandler() noexcept override
+    {
+        --alive_count;
+    }
+
+    virtual socket_t get_socket() const noexcept override
+    {
+        return _fd;
+    }
+
+    virtual void handle_accept_completed(socket_t fd) noexcept override
+    {
+        UNUSED(fd);
+        assert(false);
+    }
+
+    virtual void handle_connect_completed() noexcept override
+    {
+        assert(false);
+    }
+
+    virtual void handle_read_completed(size_t cb) noexcept override
+    {
+        UNUSED(cb);
+        assert(false); // 注销后不应再收到完成事件
+    }
+
+    virtual void handle_write_completed(size_t cb) noexcept override
+    {
+        UNUSED(cb);
+        assert(false);
+    }
+
+    virtual void handle_io_error(int err) noexcept override
+    {
+        UNUSED(err);
+        assert(false);
+    }
+
+private:
+    socket_t _fd = LOOFAH_INVALID_SOCKET_FD;
+};
+
+int OrphanHandler::alive_count = 0;
+
+/**
+ * 在非阻塞 socket 上等待读取的 handler
+ */
+class IdleReadHandler : public ProactHandler
+{
+public:
+    char buf[64];
+    size_t readed = 0;
+    int error = 0;
+
+public:
+    explicit IdleReadHandler(socket_t fd) noexcept
+        : _fd(fd)
+    {}
+
+    virtual socket_t get_socket() const noexcept override
+    {
+        return _fd;
+    }
+
+    virtual void handle_accept_completed(socket_t fd) noexcept override
+    {
+        UNUSED(fd);
+        assert(false);
+    }
+
+    virtual void handle_connect_completed() noexcept override
+    {
+        assert(false);
+    }
+
+    virtual void handle_read_completed(size_t cb) noexcept override
+    {
+        readed += cb;
+    }
+
+    virtual void handle_write_completed(size_t cb) noexcept override
+    {
+        UNUSED(cb);
+        assert(false);
+    }
+
+    virtual void handle_io_error(int err) noexcept override
+    {
+        error = err;
+    }
+
+private:
+    socket_t _fd = LOOFAH_INVALID_SOCKET_FD;
+};
+#endif
+
 }
 
 class TestProactor : public TestFixture
@@ -163,6 +280,10 @@ class TestProactor : public TestFixture
     virtual void register_cases() noexcept override
     {
         NUT_REGISTER_CASE(test_proactor);
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+        NUT_REGISTER_CASE(test_io_uring_unregister_reading);
+        NUT_REGISTER_CASE(test_io_uring_idle_read);
+#endif
     }
 
     virtual void set_up() override
@@ -192,12 +313,84 @@ class TestProactor : public TestFixture
         con.connect(proactor, addr);
 
         // loop
+        size_t completed = 0;
         while (!prepared || server != nullptr || client != nullptr)
         {
-            if (proactor->poll() < 0)
+            const int rs = proactor->poll();
+            if (rs < 0)
                 break;
+            completed += rs;
         }
+
+        // 至少包括 accept, connect, 以及双方各一次读写
+        NUT_TA(completed >= 6);
     }
+
+#if NUT_PLATFORM_OS_LINUX && LOOFAH_USE_IO_URING
+    void test_io_uring_unregister_reading()
+    {
+        if (!proactor->is_io_uring_enabled())
+            return;
+
+        int fds[2];
+        NUT_TA(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+        // 发起读请求并提交给内核
+        rc_ptr<OrphanHandler> handler = rc_new<OrphanHandler>(fds[0]);
+        proactor->register_handler(handler);
+        void *buf = handler->buf;
+        const size_t len = sizeof(handler->buf);
+        proactor->launch_read(handler, &buf, &len, 1);
+        NUT_TA(0 == proactor->poll(0));
+
+        // 读请求尚未完成时注销, 孤立的请求保持 handler 及其缓冲区有效
+        proactor->unregister_handler(handler);
+        handler = nullptr;
+        NUT_TA(1 == OrphanHandler::alive_count);
+
+        // 取消完成后释放, 之后到达的数据不会写入
+        NUT_TA(4 == ::write(fds[1], "abcd", 4));
+        for (int i = 0; i < 100 && OrphanHandler::alive_count > 0; ++i)
+            proactor->poll(10);
+        NUT_TA(0 == OrphanHandler::alive_count);
+
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    void test_io_uring_idle_read()
+    {
+        if (!proactor->is_io_uring_enabled())
+            return;
+
+        int fds[2];
+        NUT_TA(0 == ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        NUT_TA(SockOperation::set_nonblocking(fds[0]));
+
+        // 没有数据时, 非阻塞 socket 上的读请求应该等待, 而不是出错
+        rc_ptr<IdleReadHandler> handler = rc_new<IdleReadHandler>(fds[0]);
+        proactor->register_handler(handler);
+        void *buf = handler->buf;
+        const size_t len = sizeof(handler->buf);
+        proactor->launch_read(handler, &buf, &len, 1);
+        for (int i = 0; i < 5; ++i)
+            proactor->poll(10);
+        NUT_TA(0 == handler->error && 0 == handler->readed);
+
+        // 数据到达后完成
+        NUT_TA(4 == ::write(fds[1], "abcd", 4));
+        for (int i = 0; i < 100 && 0 == handler->readed; ++i)
+            proactor->poll(10);
+        NUT_TA(0 == handler->error && 4 == handler->readed);
+
+        proactor->unregister_handler(handler);
+        handler = nullptr;
+        for (int i = 0; i < 5; ++i)
+            proactor->poll(0);
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+#endif
 };
 
 NUT_REGISTER_FIXTURE(TestProactor, "proact, all")
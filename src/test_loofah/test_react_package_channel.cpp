@@ -2,10 +2,24 @@
 #include <loofah/loofah.h>
 #include <nut/nut.h>
 
+#include <stdio.h>
+#include <vector>
+
 
 #define TAG "test_react_package"
 #define LISTEN_ADDR "localhost"
 #define LISTEN_PORT 2347
+#define ET_LISTEN_PORT 2352
+#define TIMEOUT_LISTEN_PORT 2353
+#define BULK_LISTEN_PORT 2354
+#define BURST_LISTEN_PORT 2355
+#define FILE_LISTEN_PORT 2356
+#define ET_FLUSH_LISTEN_PORT 2358
+#define ET_FILE_LISTEN_PORT 2359
+#define BATCH_LISTEN_PORT 2360
+#define FLOW_CONTROL_LISTEN_PORT 2361
+#define SHARED_BUFFER_LISTEN_PORT 2362
+#define IDLE_BUFFER_LISTEN_PORT 2363
 
 using namespace nut;
 using namespace loofah;
@@ -23,6 +37,22 @@ rc_ptr<ServerChannel> server;
 rc_ptr<ClientChannel> client;
 bool prepared = false;
 
+// ping-pong 中额外覆盖的特性, 默认关闭
+bool ping_pong_batch = false; // 服务端通过 begin_batch() / flush() 写入
+bool ping_pong_flow_control = false; // 服务端单轮只读一个 package, 并暂停/恢复读取
+bool ping_pong_shared_buffer = false; // 客户端使用 reactor 的共享读缓冲
+
+rc_ptr<ReactPackageChannel> idle_server, idle_client;
+int idle_server_err = 0;
+
+std::vector<bool> backpressure_events;
+size_t bulk_pkg_size = 0, bulk_pkg_count = 0, bulk_received = 0;
+bool idle_read_buffer_held = true;
+
+FILE *send_file_fp = nullptr;
+bool send_file_after_connect = false;
+std::vector<rc_ptr<Package>> file_client_received;
+
 class ServerChannel : public ReactPackageChannel
 {
     int _counter = 0;
@@ -33,6 +63,8 @@ public:
         // Initialize
         set_reactor(reactor);
         set_time_wheel(&timewheel);
+        if (ping_pong_flow_control)
+            set_read_budget(1);
 
         // Hold reference
         server = this;
@@ -57,9 +89,30 @@ public:
 
         rc_ptr<Package> new_pkg = rc_new<Package>();
         *new_pkg << _counter;
-        write(new_pkg);
+        if (ping_pong_batch)
+        {
+            begin_batch();
+            write(new_pkg);
+            assert(is_batching());
+            flush();
+        }
+        else
+        {
+            write(new_pkg);
+        }
         NUT_LOG_D(TAG, "server send %d", _counter);
         ++_counter;
+
+        // 暂停一会儿再继续读
+        if (ping_pong_flow_control && 10 == _counter)
+        {
+            pause_reading();
+            rc_ptr<ServerChannel> ref_this(this);
+            reactor->add_timer(10, 0, [=] (PollerBase::timer_id_type) {
+                assert(ref_this->is_reading_paused());
+                ref_this->resume_reading();
+            });
+        }
     }
 
     virtual void handle_closed(int err) noexcept override
@@ -81,6 +134,8 @@ public:
         // Initialize
         set_reactor(reactor);
         set_time_wheel(&timewheel);
+        if (ping_pong_shared_buffer)
+            set_shared_read_buffer(true);
 
 		client = this;
     }
@@ -128,6 +183,243 @@ public:
     }
 };
 
+/**
+ * 连接后不收发数据, 等待读超时
+ */
+class IdleChannel : public ReactPackageChannel
+{
+    bool _is_server = false;
+
+public:
+    explicit IdleChannel(bool is_server = true) noexcept
+        : _is_server(is_server)
+    {}
+
+    virtual void initialize() noexcept override
+    {
+        set_reactor(reactor);
+        if (_is_server)
+        {
+            set_read_timeout(50);
+            idle_server = this;
+            prepared = true;
+        }
+        else
+        {
+            idle_client = this;
+        }
+    }
+
+    virtual void handle_connected() noexcept override
+    {}
+
+    virtual void handle_read(Package *pkg) noexcept override
+    {
+        assert(nullptr != pkg && pkg->readable_size() == bulk_pkg_size);
+        ++bulk_received;
+    }
+
+    virtual void handle_closed(int err) noexcept override
+    {
+        NUT_LOG_D(TAG, "idle %s closed, %d: %s", (_is_server ? "server" : "client"),
+                  err, str_error(err));
+        if (_is_server)
+        {
+            idle_server_err = err;
+            idle_server = nullptr;
+        }
+        else
+        {
+            idle_client = nullptr;
+        }
+    }
+};
+
+class IdleClientChannel : public IdleChannel
+{
+public:
+    IdleClientChannel() noexcept
+        : IdleChannel(false)
+    {}
+};
+
+/**
+ * 连接后一次性写入大量数据, 触发写队列高低水位
+ */
+class BulkServerChannel : public IdleChannel
+{
+public:
+    virtual void initialize() noexcept override
+    {
+        set_reactor(reactor);
+        set_write_watermarks(64 * 1024, 1024 * 1024);
+        idle_server = this;
+        prepared = true;
+    }
+
+    virtual void handle_connected() noexcept override
+    {
+        for (size_t i = 0; i < bulk_pkg_count; ++i)
+        {
+            rc_ptr<Package> pkg = rc_new<Package>(bulk_pkg_size);
+            pkg->skip_write(bulk_pkg_size);
+            write(pkg);
+        }
+        close();
+    }
+
+    virtual void handle_write_backpressure(bool paused) noexcept override
+    {
+        NUT_LOG_D(TAG, "write backpressure %d, queued %d bytes", paused,
+                  (int) get_write_queue_bytes());
+        backpressure_events.push_back(paused);
+    }
+};
+
+/**
+ * 连接建立后由定时器批量写入, 超过单次写出的 LOOFAH_MAX_WRITE_BUFS 限制
+ */
+class FlushServerChannel : public IdleChannel
+{
+public:
+    virtual void initialize() noexcept override
+    {
+        set_reactor(reactor);
+        set_write_timeout(1000); // 停滞时关闭
+        idle_server = this;
+        prepared = true;
+    }
+
+    virtual void handle_connected() noexcept override
+    {
+        // NOTE 推迟到连接建立后的下一轮, 注册时的首个可写事件已经过去
+        rc_ptr<FlushServerChannel> ref_this(this);
+        reactor->add_timer(10, 0, [=] (PollerBase::timer_id_type) {
+            ref_this->begin_batch();
+            for (size_t i = 0; i < bulk_pkg_count; ++i)
+            {
+                rc_ptr<Package> pkg = rc_new<Package>(bulk_pkg_size);
+                pkg->skip_write(bulk_pkg_size);
+                ref_this->write(pkg);
+            }
+            ref_this->flush();
+        });
+    }
+};
+
+/**
+ * 收齐后主动关闭; 停滞时由读超时关闭
+ */
+class FlushClientChannel : public IdleClientChannel
+{
+public:
+    virtual void initialize() noexcept override
+    {
+        IdleClientChannel::initialize();
+        set_read_timeout(1000);
+    }
+
+    virtual void handle_read(Package *pkg) noexcept override
+    {
+        IdleClientChannel::handle_read(pkg);
+        if (bulk_received == bulk_pkg_count)
+            close_later();
+    }
+};
+
+/**
+ * 收齐后空闲一会儿, 检查是否仍持有读缓冲
+ */
+class IdleBufferClientChannel : public IdleClientChannel
+{
+public:
+    virtual void initialize() noexcept override
+    {
+        IdleClientChannel::initialize();
+        set_read_timeout(1000);
+    }
+
+    virtual void handle_read(Package *pkg) noexcept override
+    {
+        IdleClientChannel::handle_read(pkg);
+        if (bulk_received != bulk_pkg_count)
+            return;
+
+        rc_ptr<IdleBufferClientChannel> ref_this(this);
+        reactor->add_timer(20, 0, [=] (PollerBase::timer_id_type) {
+            idle_read_buffer_held = (nullptr != ref_this->_reading_pkg);
+            ref_this->close();
+        });
+    }
+};
+
+/**
+ * 在两个 package 之间发送文件内容
+ */
+class FileServerChannel : public IdleChannel
+{
+public:
+    virtual void initialize() noexcept override
+    {
+        set_reactor(reactor);
+        set_write_timeout(1000); // 停滞时关闭
+        idle_server = this;
+        prepared = true;
+    }
+
+    virtual void handle_connected() noexcept override
+    {
+        if (!send_file_after_connect)
+        {
+            send_all();
+            close();
+            return;
+        }
+
+        // NOTE 推迟到连接建立后的下一轮, 并且由客户端关闭连接, 不借助关闭流程写出
+        rc_ptr<FileServerChannel> ref_this(this);
+        reactor->add_timer(10, 0, [=] (PollerBase::timer_id_type) {
+            ref_this->send_all();
+        });
+    }
+
+    void send_all() noexcept
+    {
+        rc_ptr<Package> pkg = rc_new<Package>();
+        *pkg << (int) 1;
+        write(pkg);
+
+        ::fseek(send_file_fp, 0, SEEK_END);
+        const long file_size = ::ftell(send_file_fp);
+        send_file(::fileno(send_file_fp), 10, file_size - 10);
+
+        pkg = rc_new<Package>();
+        *pkg << (int) 2;
+        write(pkg);
+    }
+};
+
+class FileClientChannel : public IdleChannel
+{
+public:
+    FileClientChannel() noexcept
+        : IdleChannel(false)
+    {}
+
+    virtual void initialize() noexcept override
+    {
+        IdleChannel::initialize();
+        set_read_timeout(1000);
+    }
+
+    virtual void handle_read(Package *pkg) noexcept override
+    {
+        file_client_received.push_back(pkg);
+        if (send_file_after_connect && 3 == file_client_received.size())
+            close_later();
+    }
+};
+
 }
 
 class TestReactPackageChannel : public TestFixture
@@ -135,11 +427,25 @@ class TestReactPackageChannel : public TestFixture
     virtual void register_cases() noexcept override
     {
         NUT_REGISTER_CASE(test_react_package_channel);
+        NUT_REGISTER_CASE(test_batch_write);
+        NUT_REGISTER_CASE(test_read_flow_control);
+        NUT_REGISTER_CASE(test_shared_read_buffer);
+        NUT_REGISTER_CASE(test_edge_triggered);
+        NUT_REGISTER_CASE(test_read_timeout);
+        NUT_REGISTER_CASE(test_write_backpressure);
+        NUT_REGISTER_CASE(test_small_frames_burst);
+        NUT_REGISTER_CASE(test_idle_read_buffer);
+        NUT_REGISTER_CASE(test_send_file);
+        NUT_REGISTER_CASE(test_edge_triggered_send_file);
     }
 
     virtual void set_up() override
     {
         reactor = new Reactor;
+        prepared = false;
+        ping_pong_batch = false;
+        ping_pong_flow_control = false;
+        ping_pong_shared_buffer = false;
     }
 
     virtual void tear_down() override
@@ -149,9 +455,194 @@ class TestReactPackageChannel : public TestFixture
     }
 
     void test_react_package_channel()
+    {
+        run_ping_pong(LISTEN_PORT);
+    }
+
+    void test_batch_write()
+    {
+        ping_pong_batch = true;
+        run_ping_pong(BATCH_LISTEN_PORT);
+    }
+
+    void test_read_flow_control()
+    {
+        ping_pong_flow_control = true;
+        run_ping_pong(FLOW_CONTROL_LISTEN_PORT);
+    }
+
+    void test_shared_read_buffer()
+    {
+        ping_pong_shared_buffer = true;
+        run_ping_pong(SHARED_BUFFER_LISTEN_PORT);
+    }
+
+    void test_edge_triggered()
+    {
+        reactor->set_edge_triggered(true);
+#if !NUT_PLATFORM_OS_WINDOWS
+        NUT_TA(reactor->is_edge_triggered());
+#endif
+        // NOTE 单轮读取预算覆盖 edge-triggered 模式下延后读取的路径
+        ping_pong_flow_control = true;
+        run_ping_pong(ET_LISTEN_PORT);
+
+        // 连接建立后的批量写入, 需要一直写到发送缓冲已满
+        InetAddr addr(LISTEN_ADDR, ET_FLUSH_LISTEN_PORT);
+        rc_ptr<ReactAcceptor<FlushServerChannel>> acc = rc_new<ReactAcceptor<FlushServerChannel> >();
+        acc->listen(addr);
+        reactor->register_handler_later(acc, ReactHandler::ACCEPT_MASK);
+
+        ReactConnector<FlushClientChannel> con;
+        con.connect(reactor, addr);
+
+        prepared = false;
+        bulk_pkg_size = 4;
+        bulk_pkg_count = 3000;
+        bulk_received = 0;
+        while (!prepared || idle_server != nullptr || idle_client != nullptr)
+        {
+            if (reactor->poll(-1) < 0)
+                break;
+        }
+        NUT_TA(bulk_pkg_count == bulk_received);
+    }
+
+    void test_read_timeout()
+    {
+        InetAddr addr(LISTEN_ADDR, TIMEOUT_LISTEN_PORT);
+        rc_ptr<ReactAcceptor<IdleChannel>> acc = rc_new<ReactAcceptor<IdleChannel> >();
+        acc->listen(addr);
+        reactor->register_handler_later(acc, ReactHandler::ACCEPT_MASK);
+
+        ReactConnector<IdleClientChannel> con;
+        con.connect(reactor, addr);
+
+        idle_server_err = 0;
+        while (!prepared || idle_server != nullptr || idle_client != nullptr)
+        {
+            if (reactor->poll(-1) < 0)
+                break;
+        }
+        NUT_TA(LOOFAH_ERR_TIMEOUT == idle_server_err);
+    }
+
+    void test_write_backpressure()
+    {
+        run_bulk(BULK_LISTEN_PORT, 256 * 1024, 64);
+        NUT_TA(2 == backpressure_events.size());
+        NUT_TA(backpressure_events.at(0) && !backpressure_events.at(1));
+    }
+
+    void test_small_frames_burst()
+    {
+        run_bulk(BURST_LISTEN_PORT, 16, 4096);
+    }
+
+    void test_idle_read_buffer()
+    {
+        InetAddr addr(LISTEN_ADDR, IDLE_BUFFER_LISTEN_PORT);
+        rc_ptr<ReactAcceptor<FlushServerChannel>> acc = rc_new<ReactAcceptor<FlushServerChannel> >();
+        acc->listen(addr);
+        reactor->register_handler_later(acc, ReactHandler::ACCEPT_MASK);
+
+        ReactConnector<IdleBufferClientChannel> con;
+        con.connect(reactor, addr);
+
+        // 突发写入后转为空闲, 默认配置下也不应继续持有读缓冲
+        bulk_pkg_size = 1024;
+        bulk_pkg_count = 64;
+        bulk_received = 0;
+        idle_read_buffer_held = true;
+        while (!prepared || idle_server != nullptr || idle_client != nullptr)
+        {
+            if (reactor->poll(-1) < 0)
+                break;
+        }
+        NUT_TA(bulk_pkg_count == bulk_received);
+        NUT_TA(!idle_read_buffer_held);
+    }
+
+    void test_send_file()
+    {
+        run_send_file(FILE_LISTEN_PORT);
+    }
+
+    void test_edge_triggered_send_file()
+    {
+        reactor->set_edge_triggered(true);
+        send_file_after_connect = true;
+        run_send_file(ET_FILE_LISTEN_PORT);
+        send_file_after_connect = false;
+    }
+
+    void run_send_file(int port)
+    {
+        // Prepare file
+        send_file_fp = ::tmpfile();
+        NUT_TA(nullptr != send_file_fp);
+        std::vector<uint8_t> content(300 * 1024);
+        for (size_t i = 0, sz = content.size(); i < sz; ++i)
+            content[i] = (uint8_t) (i * 7);
+        NUT_TA(content.size() == ::fwrite(content.data(), 1, content.size(), send_file_fp));
+        ::fflush(send_file_fp);
+
+        InetAddr addr(LISTEN_ADDR, port);
+        rc_ptr<ReactAcceptor<FileServerChannel>> acc = rc_new<ReactAcceptor<FileServerChannel> >();
+        acc->listen(addr);
+        reactor->register_handler_later(acc, ReactHandler::ACCEPT_MASK);
+
+        ReactConnector<FileClientChannel> con;
+        con.connect(reactor, addr);
+
+        file_client_received.clear();
+        while (!prepared || idle_server != nullptr || idle_client != nullptr)
+        {
+            if (reactor->poll(-1) < 0)
+                break;
+        }
+        ::fclose(send_file_fp);
+        send_file_fp = nullptr;
+
+        // 文件内容夹在两个 package 之间
+        NUT_TA(3 == file_client_received.size());
+        int tmp = 0;
+        *file_client_received.at(0) >> tmp;
+        NUT_TA(1 == tmp);
+        Package *file_pkg = file_client_received.at(1);
+        NUT_TA(file_pkg->readable_size() == content.size() - 10);
+        NUT_TA(0 == ::memcmp(file_pkg->readable_data(), content.data() + 10, content.size() - 10));
+        *file_client_received.at(2) >> tmp;
+        NUT_TA(2 == tmp);
+        file_client_received.clear();
+    }
+
+    void run_bulk(int port, size_t pkg_size, size_t pkg_count)
+    {
+        InetAddr addr(LISTEN_ADDR, port);
+        rc_ptr<ReactAcceptor<BulkServerChannel>> acc = rc_new<ReactAcceptor<BulkServerChannel> >();
+        acc->listen(addr);
+        reactor->register_handler_later(acc, ReactHandler::ACCEPT_MASK);
+
+        ReactConnector<IdleClientChannel> con;
+        con.connect(reactor, addr);
+
+        bulk_pkg_size = pkg_size;
+        bulk_pkg_count = pkg_count;
+        bulk_received = 0;
+        backpressure_events.clear();
+        while (!prepared || idle_server != nullptr || idle_client != nullptr)
+        {
+            if (reactor->poll(-1) < 0)
+                break;
+        }
+        NUT_TA(pkg_count == bulk_received);
+    }
+
+    void run_ping_pong(int port)
     {
         // Start server
-        InetAddr addr(LISTEN_ADDR, LISTEN_PORT);
+        InetAddr addr(LISTEN_ADDR, port);
         rc_ptr<ReactAcceptor<ServerChannel>> acc = rc_new<ReactAcceptor<ServerChannel> >();
         acc->listen(addr);
         reactor->register_handler_later(acc, ReactHandler::ACCEPT_MASK);
@@ -0,0 +1,82 @@
+﻿
+#include <loofah/loofah.h>
+#include <nut/nut.h>
+
+#include <thread>
+#include <vector>
+
+
+#define PRODUCER_COUNT 4
+#define TASK_COUNT 10000
+
+using namespace nut;
+using namespace loofah;
+
+class TestTaskQueue : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_order);
+        NUT_REGISTER_CASE(test_multi_producer);
+    }
+
+    void test_order()
+    {
+        TaskQueue queue;
+        std::vector<int> result;
+        for (int i = 0; i < 3; ++i)
+            queue.push([&result,i] { result.push_back(i); });
+
+        TaskQueue::Node *node = nullptr;
+        while (nullptr != (node = queue.pop()))
+        {
+            node->run();
+            delete node;
+        }
+        NUT_TA(3 == result.size());
+        NUT_TA(0 == result[0] && 1 == result[1] && 2 == result[2]);
+    }
+
+    void test_multi_producer()
+    {
+        TaskQueue queue;
+        int counts[PRODUCER_COUNT] = {0};
+        bool ordered = true;
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < PRODUCER_COUNT; ++p)
+        {
+            producers.emplace_back([&,p] {
+                for (int i = 0; i < TASK_COUNT; ++i)
+                {
+                    // 同一生产者的任务保持顺序
+                    queue.push([&counts,&ordered,p,i] {
+                        ordered = ordered && (counts[p] == i);
+                        ++counts[p];
+                    });
+                }
+            });
+        }
+
+        int total = 0;
+        while (total < PRODUCER_COUNT * TASK_COUNT)
+        {
+            TaskQueue::Node *node = queue.pop();
+            if (nullptr == node)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            node->run();
+            delete node;
+            ++total;
+        }
+        for (std::thread& t : producers)
+            t.join();
+
+        NUT_TA(ordered);
+        NUT_TA(nullptr == queue.pop());
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestTaskQueue, "inet_base, all")
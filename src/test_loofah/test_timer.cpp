@@ -0,0 +1,65 @@
+﻿
+#include <loofah/loofah.h>
+#include <nut/nut.h>
+
+#include <vector>
+
+
+using namespace nut;
+using namespace loofah;
+
+class TestTimer : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_timer_queue);
+        NUT_REGISTER_CASE(test_poll_timeout);
+    }
+
+    void test_timer_queue()
+    {
+        TimerQueue timers;
+        std::vector<int> fired;
+        timers.add_timer(20, 0, [&] (TimerQueue::timer_id_type) { fired.push_back(2); });
+        timers.add_timer(10, 0, [&] (TimerQueue::timer_id_type) { fired.push_back(1); });
+        const TimerQueue::timer_id_type id3 = timers.add_timer(
+            30, 0, [&] (TimerQueue::timer_id_type) { fired.push_back(3); });
+        const TimerQueue::timer_id_type id4 = timers.add_timer(
+            40, 0, [&] (TimerQueue::timer_id_type) { fired.push_back(4); });
+        NUT_TA(4 == timers.size());
+
+        // 取消、推迟
+        NUT_TA(timers.cancel_timer(id3));
+        NUT_TA(!timers.cancel_timer(id3));
+        NUT_TA(timers.reset_timer(id4, 100));
+
+        const uint64_t now = TimerQueue::now_ms();
+        NUT_TA(timers.get_idle_ms(now) <= 10);
+        timers.run_expired(now + 50);
+        NUT_TA(2 == fired.size() && 1 == fired[0] && 2 == fired[1]);
+        NUT_TA(1 == timers.size());
+
+        timers.run_expired(now + 200);
+        NUT_TA(3 == fired.size() && 4 == fired[2]);
+        NUT_TA(0 == timers.size() && timers.get_idle_ms(now) < 0);
+    }
+
+    void test_poll_timeout()
+    {
+        Reactor reactor;
+        int count = 0;
+        reactor.add_timer(10, 10, [&] (PollerBase::timer_id_type id) {
+            if (++count >= 3)
+                reactor.cancel_timer(id);
+        });
+
+        // 无限等待也会因定时器到期而返回
+        const uint64_t start = TimerQueue::now_ms();
+        while (count < 3)
+            NUT_TA(0 == reactor.poll(-1));
+        NUT_TA(TimerQueue::now_ms() - start < 1000);
+        NUT_TA(3 == count);
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestTimer, "inet_base, all")
@@ -0,0 +1,71 @@
+﻿
+#include <loofah/loofah.h>
+#include <nut/nut.h>
+
+
+using namespace nut;
+using namespace loofah;
+
+class TestWriteQueue : public TestFixture
+{
+    virtual void register_cases() noexcept override
+    {
+        NUT_REGISTER_CASE(test_ring);
+        NUT_REGISTER_CASE(test_bytes);
+    }
+
+    static WriteEntry make_entry(size_t len) noexcept
+    {
+        WriteEntry entry;
+        entry.pkg = rc_new<Package>(len);
+        entry.pkg->skip_write(len);
+        return entry;
+    }
+
+    void test_ring()
+    {
+        WriteQueue q;
+        NUT_TA(q.empty() && 0 == q.bytes());
+
+        // 超过内联容量后扩容, 并保持顺序
+        const size_t count = WriteQueue::INLINE_CAPACITY * 3 + 1;
+        for (size_t i = 1; i <= count; ++i)
+            q.push_back(make_entry(i));
+        NUT_TA(count == q.size());
+        for (size_t i = 0; i < count; ++i)
+            NUT_TA(i + 1 == q[i].size());
+
+        // 头部插入, 环形回绕
+        q.pop_front();
+        q.pop_front();
+        q.push_front(make_entry(100));
+        NUT_TA(100 == q.front().size());
+        NUT_TA(3 == q[1].size());
+
+        q.clear();
+        NUT_TA(q.empty() && 0 == q.bytes());
+
+        // 排空后仍可正常使用
+        q.push_back(make_entry(5));
+        NUT_TA(1 == q.size() && 5 == q.front().size());
+    }
+
+    void test_bytes()
+    {
+        WriteQueue q;
+        q.push_back(make_entry(10));
+        q.push_back(make_entry(20));
+        NUT_TA(30 == q.bytes());
+
+        q.skip_front(4);
+        NUT_TA(26 == q.bytes() && 6 == q.front().size());
+
+        q.pop_front();
+        NUT_TA(20 == q.bytes());
+
+        q.push_front(make_entry(7));
+        NUT_TA(27 == q.bytes());
+    }
+};
+
+NUT_REGISTER_FIXTURE(TestWriteQueue, "package, all")